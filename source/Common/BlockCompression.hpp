@@ -0,0 +1,276 @@
+#ifndef _BLOCK_COMPRESSION_HPP_
+#define _BLOCK_COMPRESSION_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/Buffer.hpp"
+#include "Common/GLMInc.hpp"
+#include "Common/SIMD.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+enum class BlockFormat
+{
+    BC1 = 0,    // rgb, 8 bytes per block
+    BC3,        // rgba, bc1 color and bc4 alpha
+    BC4,        // r
+    BC5,        // rg, two bc4 blocks
+};
+
+// Fast BCn encoders for 4x4 blocks. Color endpoints are the extremes along the principal
+// axis of the block, inset by 1/16 of the range, indices come from projecting the
+// pixels onto the endpoint line (SSE2 for four pixels at a time).
+class BlockCompression
+{
+public:
+    static size_t blockSize(BlockFormat format)
+    {
+        return (BlockFormat::BC1 == format || BlockFormat::BC4 == format) ? 8 : 16;
+    }
+
+    static size_t levelSize(BlockFormat format, size_t width, size_t height)
+    {
+        return ((width + 3) / 4) * ((height + 3) / 4) * blockSize(format);
+    }
+
+    // block rows [rowBegin, rowEnd) of the image, out points at the first block of rowBegin
+    static void compressRows(const Buffer<RGBA> &image, BlockFormat format, size_t rowBegin, size_t rowEnd, uint8_t *out)
+    {
+        size_t width = image.getWidth();
+        size_t height = image.getHeight();
+        size_t blocksX = (width + 3) / 4;
+
+        RGBA block[16];
+        for (size_t by = rowBegin; by < rowEnd; by++)
+        {
+            for (size_t bx = 0; bx < blocksX; bx++)
+            {
+                // edge blocks repeat the last row and column
+                for (size_t y = 0; y < 4; y++)
+                {
+                    for (size_t x = 0; x < 4; x++)
+                    {
+                        size_t px = std::min(bx * 4 + x, width - 1);
+                        size_t py = std::min(by * 4 + y, height - 1);
+                        block[y * 4 + x] = image.getRawDataPtr()[px + py * width];
+                    }
+                }
+
+                compressBlock(block, format, out);
+                out += blockSize(format);
+            }
+        }
+    }
+
+    static void compressBlock(const RGBA *block, BlockFormat format, uint8_t *out)
+    {
+        uint8_t channel[16];
+        switch (format)
+        {
+            case BlockFormat::BC1:
+                encodeColorBlock(block, out);
+                break;
+            case BlockFormat::BC3:
+                extractChannel(block, 3, channel);
+                encodeBC4Block(channel, out);
+                encodeColorBlock(block, out + 8);
+                break;
+            case BlockFormat::BC4:
+                extractChannel(block, 0, channel);
+                encodeBC4Block(channel, out);
+                break;
+            case BlockFormat::BC5:
+                extractChannel(block, 0, channel);
+                encodeBC4Block(channel, out);
+                extractChannel(block, 1, channel);
+                encodeBC4Block(channel, out + 8);
+                break;
+        }
+    }
+
+    // always four color mode, so the same block is valid inside bc3
+    static void encodeColorBlock(const RGBA *block, uint8_t *out)
+    {
+        glm::vec3 colors[16];
+        glm::vec3 mean(0.0f);
+        for (int i = 0; i < 16; i++)
+        {
+            colors[i] = glm::vec3(block[i].r, block[i].g, block[i].b);
+            mean += colors[i];
+        }
+        mean /= 16.0f;
+
+        // covariance and power iteration for the principal axis
+        float cov[6] = {0.0f};
+        for (auto &color : colors)
+        {
+            glm::vec3 d = color - mean;
+            cov[0] += d.r * d.r;
+            cov[1] += d.r * d.g;
+            cov[2] += d.r * d.b;
+            cov[3] += d.g * d.g;
+            cov[4] += d.g * d.b;
+            cov[5] += d.b * d.b;
+        }
+        glm::vec3 axis(1.0f, 1.0f, 1.0f);
+        for (int iter = 0; iter < 4; iter++)
+        {
+            glm::vec3 next(cov[0] * axis.r + cov[1] * axis.g + cov[2] * axis.b,
+                           cov[1] * axis.r + cov[3] * axis.g + cov[4] * axis.b,
+                           cov[2] * axis.r + cov[4] * axis.g + cov[5] * axis.b);
+            float len = std::max(std::abs(next.r), std::max(std::abs(next.g), std::abs(next.b)));
+            if (len < 1e-4f)
+            {
+                break;
+            }
+            axis = next / len;
+        }
+
+        float minDot = std::numeric_limits<float>::max();
+        float maxDot = -std::numeric_limits<float>::max();
+        glm::vec3 minColor = colors[0];
+        glm::vec3 maxColor = colors[0];
+        for (auto &color : colors)
+        {
+            float dot = glm::dot(color, axis);
+            if (dot < minDot)
+            {
+                minDot = dot;
+                minColor = color;
+            }
+            if (dot > maxDot)
+            {
+                maxDot = dot;
+                maxColor = color;
+            }
+        }
+
+        glm::vec3 inset = (maxColor - minColor) / 16.0f;
+        uint16_t color0 = packRGB565(maxColor - inset);
+        uint16_t color1 = packRGB565(minColor + inset);
+        if (color0 < color1)
+        {
+            std::swap(color0, color1);
+        }
+
+        uint32_t indices = 0;
+        if (color0 != color1)
+        {
+            indices = selectColorIndices(colors, unpackRGB565(color0), unpackRGB565(color1));
+        }
+
+        out[0] = (uint8_t) (color0 & 0xFF);
+        out[1] = (uint8_t) (color0 >> 8);
+        out[2] = (uint8_t) (color1 & 0xFF);
+        out[3] = (uint8_t) (color1 >> 8);
+        out[4] = (uint8_t) (indices & 0xFF);
+        out[5] = (uint8_t) ((indices >> 8) & 0xFF);
+        out[6] = (uint8_t) ((indices >> 16) & 0xFF);
+        out[7] = (uint8_t) (indices >> 24);
+    }
+
+    // eight value mode, endpoints are the block min and max
+    static void encodeBC4Block(const uint8_t *values, uint8_t *out)
+    {
+        uint8_t minValue = 255;
+        uint8_t maxValue = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            minValue = std::min(minValue, values[i]);
+            maxValue = std::max(maxValue, values[i]);
+        }
+
+        out[0] = maxValue;
+        out[1] = minValue;
+
+        uint64_t indices = 0;
+        if (maxValue > minValue)
+        {
+            // step 0 is max, 7 is min, the palette order is max, min, then the interpolants
+            static const uint64_t stepToIndex[8] = {0, 2, 3, 4, 5, 6, 7, 1};
+            float scale = 7.0f / (float) (maxValue - minValue);
+            for (int i = 0; i < 16; i++)
+            {
+                int step = (int) ((float) (maxValue - values[i]) * scale + 0.5f);
+                indices |= stepToIndex[std::min(step, 7)] << (3 * i);
+            }
+        }
+
+        for (int i = 0; i < 6; i++)
+        {
+            out[2 + i] = (uint8_t) ((indices >> (8 * i)) & 0xFF);
+        }
+    }
+
+private:
+    static void extractChannel(const RGBA *block, int channel, uint8_t *out)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            out[i] = block[i][channel];
+        }
+    }
+
+    static uint16_t packRGB565(const glm::vec3 &color)
+    {
+        glm::vec3 c = glm::clamp(color, 0.0f, 255.0f);
+        auto r = (uint16_t) (c.r * 31.0f / 255.0f + 0.5f);
+        auto g = (uint16_t) (c.g * 63.0f / 255.0f + 0.5f);
+        auto b = (uint16_t) (c.b * 31.0f / 255.0f + 0.5f);
+        return (uint16_t) ((r << 11) | (g << 5) | b);
+    }
+
+    static glm::vec3 unpackRGB565(uint16_t color)
+    {
+        uint32_t r = (color >> 11) & 0x1F;
+        uint32_t g = (color >> 5) & 0x3F;
+        uint32_t b = color & 0x1F;
+        return glm::vec3((float) ((r << 3) | (r >> 2)), (float) ((g << 2) | (g >> 4)), (float) ((b << 3) | (b >> 2)));
+    }
+
+    // 2 bit index per pixel: 0 is color0, 1 is color1, 2 and 3 the 1/3 and 2/3 points
+    static uint32_t selectColorIndices(const glm::vec3 *colors, const glm::vec3 &color0, const glm::vec3 &color1)
+    {
+        glm::vec3 dir = color1 - color0;
+        float lenSq = glm::dot(dir, dir);
+        float scale = lenSq > 0.0f ? 3.0f / lenSq : 0.0f;
+        float offset = -glm::dot(color0, dir) * scale;
+
+        int steps[16];
+#if defined(SIMD_SSE2)
+        const __m128 dirR = _mm_set1_ps(dir.r * scale);
+        const __m128 dirG = _mm_set1_ps(dir.g * scale);
+        const __m128 dirB = _mm_set1_ps(dir.b * scale);
+        const __m128 base = _mm_set1_ps(offset + 0.5f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 three = _mm_set1_ps(3.0f);
+        for (int i = 0; i < 16; i += 4)
+        {
+            __m128 r = _mm_set_ps(colors[i + 3].r, colors[i + 2].r, colors[i + 1].r, colors[i].r);
+            __m128 g = _mm_set_ps(colors[i + 3].g, colors[i + 2].g, colors[i + 1].g, colors[i].g);
+            __m128 b = _mm_set_ps(colors[i + 3].b, colors[i + 2].b, colors[i + 1].b, colors[i].b);
+            __m128 t = _mm_add_ps(base, _mm_add_ps(_mm_mul_ps(r, dirR), _mm_add_ps(_mm_mul_ps(g, dirG), _mm_mul_ps(b, dirB))));
+            t = _mm_min_ps(_mm_max_ps(t, zero), three);
+            _mm_storeu_si128((__m128i *) &steps[i], _mm_cvttps_epi32(t));
+        }
+#else
+        for (int i = 0; i < 16; i++)
+        {
+            float t = glm::dot(colors[i], dir) * scale + offset + 0.5f;
+            steps[i] = (int) std::min(std::max(t, 0.0f), 3.0f);
+        }
+#endif
+
+        static const uint32_t stepToIndex[4] = {0, 2, 3, 1};
+        uint32_t indices = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            indices |= stepToIndex[steps[i]] << (2 * i);
+        }
+        return indices;
+    }
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _BLOCK_COMPRESSION_HPP_
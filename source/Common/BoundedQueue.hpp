@@ -0,0 +1,65 @@
+#ifndef _BOUNDED_QUEUE_HPP_
+#define _BOUNDED_QUEUE_HPP_
+
+#include "Common/cpplang.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Blocking FIFO between pipeline stages, push waits while full, pop while empty.
+// After close, pushes fail and pops drain what is left.
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity = std::numeric_limits<size_t>::max())
+        : m_capacity(std::max(capacity, (size_t) 1))
+    {
+    }
+
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notFull.wait(lock, [&]() { return m_closed || m_items.size() < m_capacity; });
+        if (m_closed)
+        {
+            return false;
+        }
+        m_items.push_back(std::move(item));
+        m_notEmpty.notify_one();
+        return true;
+    }
+
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_notEmpty.wait(lock, [&]() { return m_closed || !m_items.empty(); });
+        if (m_items.empty())
+        {
+            return false;
+        }
+        item = std::move(m_items.front());
+        m_items.pop_front();
+        m_notFull.notify_one();
+        return true;
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        m_notEmpty.notify_all();
+        m_notFull.notify_all();
+    }
+
+private:
+    size_t m_capacity;
+    bool m_closed = false;
+    std::deque<T> m_items;
+    std::mutex m_mutex;
+    std::condition_variable m_notEmpty;
+    std::condition_variable m_notFull;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _BOUNDED_QUEUE_HPP_
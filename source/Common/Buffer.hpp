@@ -41,6 +41,18 @@ public:
         }
     }
 
+    // takes over storage already laid out for this buffer, its deleter frees it
+    void adopt(size_t width, size_t height, std::shared_ptr<T> data)
+    {
+        m_width = width;
+        m_height = height;
+
+        initLayout();
+
+        m_dataSize = m_innerWidth * m_innerHeight;
+        m_data = std::move(data);
+    }
+
     T *get(size_t x, size_t y)
     {
         T *ptr = m_data.get();
@@ -0,0 +1,124 @@
+#ifndef _DISK_CACHE_HPP_
+#define _DISK_CACHE_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/FileUtils.hpp"
+#include "Common/Logger.hpp"
+#include "Common/WindowsInc.hpp"
+
+#include <atomic>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+BEGIN_NAMESPACE(GLBase)
+
+// File layout shared by the on-disk caches: one file per 64 bit key in the cache directory,
+// starting with magic, version and key. A file whose header does not match is ignored and
+// rewritten by the next store, the cache specific fields and the payload follow the header.
+class DiskCache
+{
+public:
+    static constexpr size_t HEADER_SIZE = 16;
+
+    // name is only for the log
+    DiskCache(const std::string &dir, const std::string &extension, uint32_t magic, uint32_t version, const std::string &name)
+        : m_dir(dir), m_extension(extension), m_magic(magic), m_version(version), m_name(name)
+    {
+    }
+
+    std::string getPath(uint64_t key) const
+    {
+        char name[32];
+        snprintf(name, sizeof(name), "%016llx.", (unsigned long long) key);
+        return m_dir + name + m_extension;
+    }
+
+    bool exists(uint64_t key) const
+    {
+        return FileUtils::exists(getPath(key));
+    }
+
+    // false if the file is too short or belongs to another cache, version or key
+    bool checkHeader(const uint8_t *data, size_t size, uint64_t key) const
+    {
+        Header header{};
+        if (size >= HEADER_SIZE)
+        {
+            memcpy(&header, data, HEADER_SIZE);
+        }
+        if (header.magic != m_magic || header.version != m_version || header.key != key)
+        {
+            LOGW("%s mismatch: %s", m_name.c_str(), getPath(key).c_str());
+            return false;
+        }
+        return true;
+    }
+
+    // data starts empty, the caller appends its fields and payload
+    void writeHeader(std::vector<uint8_t> &data, uint64_t key) const
+    {
+        Header header{m_magic, m_version, key};
+        data.insert(data.end(), (const uint8_t *) &header, (const uint8_t *) &header + HEADER_SIZE);
+    }
+
+    // written next to the target and moved over it, a process that still maps the old file
+    // keeps its pages instead of seeing the file truncated under it
+    bool write(uint64_t key, const std::vector<uint8_t> &data) const
+    {
+        if (!FileUtils::createDirectory(m_dir))
+        {
+            LOGE("%s create directory failed: %s", m_name.c_str(), m_dir.c_str());
+            return false;
+        }
+        std::string path = getPath(key);
+        std::string tmpPath = path + tmpSuffix();
+        if (!FileUtils::writeBytes(tmpPath, (const char *) data.data(), data.size()))
+        {
+            LOGE("%s write failed: %s", m_name.c_str(), tmpPath.c_str());
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        if (!FileUtils::moveFile(tmpPath, path))
+        {
+            std::remove(tmpPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+private:
+    // unique per process and write, two writers of the same key never share a temporary
+    static std::string tmpSuffix()
+    {
+        static std::atomic<uint32_t> counter(0);
+#ifdef _WIN32
+        unsigned long pid = GetCurrentProcessId();
+#else
+        unsigned long pid = (unsigned long) getpid();
+#endif
+        char suffix[48];
+        snprintf(suffix, sizeof(suffix), ".%lu.%u.tmp", pid, (unsigned) counter++);
+        return suffix;
+    }
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t key;
+    };
+    static_assert(sizeof(Header) == HEADER_SIZE, "cache file header must stay packed");
+
+private:
+    std::string m_dir;
+    std::string m_extension;
+    uint32_t m_magic;
+    uint32_t m_version;
+    std::string m_name;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _DISK_CACHE_HPP_
@@ -5,6 +5,18 @@
 
 #include "Common/Logger.hpp"
 
+#include "Common/WindowsInc.hpp"
+
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
 BEGIN_NAMESPACE(GLBase)
 
 class FileUtils
@@ -16,6 +28,29 @@ public:
         return file.good();
     }
 
+    // absolute path with links and dot segments resolved, the path as is if it does not exist
+    static std::string canonicalPath(const std::string &path)
+    {
+#ifdef _WIN32
+        char buffer[_MAX_PATH];
+        bool ret = _fullpath(buffer, path.c_str(), _MAX_PATH) != nullptr;
+#else
+        char buffer[PATH_MAX];
+        bool ret = realpath(path.c_str(), buffer) != nullptr;
+#endif
+        return ret ? std::string(buffer) : path;
+    }
+
+    static bool createDirectory(const std::string &path)
+    {
+#ifdef _WIN32
+        int ret = _mkdir(path.c_str());
+#else
+        int ret = mkdir(path.c_str(), 0755);
+#endif
+        return 0 == ret || EEXIST == errno;
+    }
+
     static std::vector<uint8_t> readBytes(const std::string &path)
     {
         std::vector<uint8_t> ret;
@@ -64,7 +99,22 @@ public:
         file.write(data, length);
         file.close();
 
-        return true;
+        return !file.fail();
+    }
+
+    // replaces an existing target in one step, readers never see a partial file
+    static bool moveFile(const std::string &from, const std::string &to)
+    {
+#ifdef _WIN32
+        bool ret = MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+        bool ret = 0 == std::rename(from.c_str(), to.c_str());
+#endif
+        if (!ret)
+        {
+            LOGE("failed to move file: %s -> %s", from.c_str(), to.c_str());
+        }
+        return ret;
     }
 
     static bool writeText(const std::string &path, const std::string &str)
@@ -13,6 +13,42 @@ public:
     {
         seed ^= std::hash<T>()(v) + 0x9e3779b9u + (seed << 6u) + (seed >> 2u);
     }
+
+    // FNV-1a 64, stable across runs and platforms unlike std::hash
+    static uint64_t hashBytes(const void *data, size_t length, uint64_t seed = 0xcbf29ce484222325ull)
+    {
+        auto *bytes = (const uint8_t *) data;
+        uint64_t hash = seed;
+        for (size_t i = 0; i < length; i++)
+        {
+            hash ^= bytes[i];
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    // 8 bytes per step for large blobs like file contents, the tail goes through hashBytes
+    static uint64_t hashContent(const void *data, size_t length, uint64_t seed = 0x9e3779b97f4a7c15ull)
+    {
+        auto *bytes = (const uint8_t *) data;
+        uint64_t hash = seed ^ (length * 0xff51afd7ed558ccdull);
+        size_t words = length / sizeof(uint64_t);
+        for (size_t i = 0; i < words; i++)
+        {
+            uint64_t word;
+            memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(uint64_t));
+            word *= 0xc4ceb9fe1a85ec53ull;
+            word ^= word >> 31;
+            hash = (hash ^ word) * 0x9fb21c651e98df25ull;
+            hash ^= hash >> 29;
+        }
+        return hashBytes(bytes + words * sizeof(uint64_t), length - words * sizeof(uint64_t), hash);
+    }
+
+    static uint64_t hashString(const std::string &str, uint64_t seed = 0xcbf29ce484222325ull)
+    {
+        return hashBytes(str.data(), str.length(), seed);
+    }
 };
 
 END_NAMESPACE(GLBase)
@@ -12,6 +12,7 @@
 #include "Common/Buffer.hpp"
 #include "Common/GLMInc.hpp"
 #include "Common/Logger.hpp"
+#include "Common/SIMD.hpp"
 
 BEGIN_NAMESPACE(GLBase)
 
@@ -64,62 +65,146 @@ public:
     static std::shared_ptr<Buffer<RGBA>> readImageRGBA(const std::string &path)
     {
         int width, height, components;
-        unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, STBI_default);
+        unsigned char *data = stbi_load(path.c_str(), &width, &height, &components, STBI_rgb_alpha);
         if (nullptr == data)
         {
             LOGE("ImageUtils::readImageRGBA failed to load image with path: %s", path.c_str());
             return nullptr;
         }
 
-        auto buffer = Buffer<RGBA>::makeDefault(width, height);
-        for(int y = 0; y < height; y++)
+        return adoptRGBA(data, width, height);
+    }
+
+    // encoded file contents already in memory, name is only for the log
+    static std::shared_ptr<Buffer<RGBA>> readImageRGBA(const uint8_t *bytes, size_t length, const std::string &name)
+    {
+        int width, height, components;
+        unsigned char *data = stbi_load_from_memory(bytes, (int) length, &width, &height, &components, STBI_rgb_alpha);
+        if (nullptr == data)
+        {
+            LOGE("ImageUtils::readImageRGBA failed to decode image: %s", name.c_str());
+            return nullptr;
+        }
+
+        return adoptRGBA(data, width, height);
+    }
+
+    // size of the encoded image without decoding it
+    static bool readImageInfo(const uint8_t *bytes, size_t length, int &width, int &height)
+    {
+        int components;
+        return stbi_info_from_memory(bytes, (int) length, &width, &height, &components) != 0;
+    }
+
+    // full chain down to 1x1 starting with the given level 0, 2x2 box filter. srgb averages
+    // the color channels in linear space so that minified color maps keep their brightness
+    static std::vector<std::shared_ptr<Buffer<RGBA>>> generateMipmaps(const std::shared_ptr<Buffer<RGBA>> &level0, bool srgb = false)
+    {
+        std::vector<std::shared_ptr<Buffer<RGBA>>> levels = {level0};
+        while (levels.back()->getWidth() > 1 || levels.back()->getHeight() > 1)
         {
-            for(int x = 0; x < width; x++)
+            auto &src = *levels.back();
+            auto dst = Buffer<RGBA>::makeDefault(std::max((size_t) 1, src.getWidth() / 2), std::max((size_t) 1, src.getHeight() / 2));
+            if (srgb)
             {
-                auto &to = *buffer->get(x, y);
-                size_t index = x + y * width;
+                downsampleSRGB(src, *dst);
+            }
+            else
+            {
+                downsampleLinear(src, *dst);
+            }
+            levels.push_back(dst);
+        }
+
+        return levels;
+    }
+
+    static void downsampleLinear(const Buffer<RGBA> &src, Buffer<RGBA> &dst)
+    {
+        size_t srcWidth = src.getWidth();
+        size_t srcHeight = src.getHeight();
+        for (size_t y = 0; y < dst.getHeight(); y++)
+        {
+            const RGBA *row0 = src.getRawDataPtr() + std::min(y * 2, srcHeight - 1) * srcWidth;
+            const RGBA *row1 = src.getRawDataPtr() + std::min(y * 2 + 1, srcHeight - 1) * srcWidth;
+            RGBA *out = dst.getRawDataPtr() + y * dst.getWidth();
 
-                switch(components)
+            size_t x = 0;
+#if defined(SIMD_SSE2)
+            // two output texels per step, 16 bit sums of the four source texels
+            if (srcWidth >= 2)
+            {
+                const __m128i zero = _mm_setzero_si128();
+                const __m128i round = _mm_set1_epi16(2);
+                for (; x + 2 <= dst.getWidth(); x += 2)
                 {
-                    case STBI_grey:
-                    {
-                        to.r = data[index];
-                        to.g = to.b = to.r;
-                        to.a = 255;
-                        break;
-                    };
-                    case STBI_grey_alpha:
-                    {
-                        to.r = data[index * 2 + 0];
-                        to.g = to.b = to.r;
-                        to.a = data[index * 2 + 1];
-                        break;
-                    };
-                    case STBI_rgb:
-                    {
-                        to.r = data[index * 3 + 0];
-                        to.g = data[index * 3 + 1];
-                        to.b = data[index * 3 + 2];
-                        to.a = 255;
-                        break;
-                    };
-                    case STBI_rgb_alpha:
-                    {
-                        to.r = data[index * 4 + 0];
-                        to.g = data[index * 4 + 1];
-                        to.b = data[index * 4 + 2];
-                        to.a = data[index * 4 + 3];
-                        break;
-                    };
-                    default:
-                        break;
+                    __m128i a = _mm_loadu_si128((const __m128i *) (row0 + x * 2));
+                    __m128i b = _mm_loadu_si128((const __m128i *) (row1 + x * 2));
+                    __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+                    __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+                    lo = _mm_add_epi16(lo, _mm_srli_si128(lo, 8));
+                    hi = _mm_add_epi16(hi, _mm_srli_si128(hi, 8));
+                    __m128i sum = _mm_srli_epi16(_mm_add_epi16(_mm_unpacklo_epi64(lo, hi), round), 2);
+                    _mm_storel_epi64((__m128i *) (out + x), _mm_packus_epi16(sum, zero));
                 }
             }
+#endif
+            for (; x < dst.getWidth(); x++)
+            {
+                size_t x0 = std::min(x * 2, srcWidth - 1);
+                size_t x1 = std::min(x * 2 + 1, srcWidth - 1);
+                glm::u32vec4 sum = glm::u32vec4(row0[x0]) + glm::u32vec4(row0[x1]) + glm::u32vec4(row1[x0]) + glm::u32vec4(row1[x1]);
+                out[x] = RGBA((sum + 2u) / 4u);
+            }
         }
+    }
 
-        stbi_image_free(data);
+    // color through the srgb to linear table, alpha stays linear
+    static void downsampleSRGB(const Buffer<RGBA> &src, Buffer<RGBA> &dst)
+    {
+        const float *toLinear = getSRGBToLinearTable();
+        const uint8_t *toSRGB = getLinearToSRGBTable();
 
-        return buffer;
+        size_t srcWidth = src.getWidth();
+        size_t srcHeight = src.getHeight();
+        for (size_t y = 0; y < dst.getHeight(); y++)
+        {
+            const RGBA *row0 = src.getRawDataPtr() + std::min(y * 2, srcHeight - 1) * srcWidth;
+            const RGBA *row1 = src.getRawDataPtr() + std::min(y * 2 + 1, srcHeight - 1) * srcWidth;
+            RGBA *out = dst.getRawDataPtr() + y * dst.getWidth();
+
+            for (size_t x = 0; x < dst.getWidth(); x++)
+            {
+                const RGBA *texels[4] = {&row0[std::min(x * 2, srcWidth - 1)], &row0[std::min(x * 2 + 1, srcWidth - 1)],
+                                         &row1[std::min(x * 2, srcWidth - 1)], &row1[std::min(x * 2 + 1, srcWidth - 1)]};
+                float result[4];
+#if defined(SIMD_SSE2)
+                __m128 sum = _mm_setzero_ps();
+                for (auto *texel : texels)
+                {
+                    sum = _mm_add_ps(sum, _mm_set_ps((float) texel->a * (1.0f / 255.0f), toLinear[texel->b], toLinear[texel->g], toLinear[texel->r]));
+                }
+                _mm_storeu_ps(result, _mm_mul_ps(sum, _mm_set1_ps(0.25f)));
+#else
+                result[0] = result[1] = result[2] = result[3] = 0.0f;
+                for (auto *texel : texels)
+                {
+                    result[0] += toLinear[texel->r];
+                    result[1] += toLinear[texel->g];
+                    result[2] += toLinear[texel->b];
+                    result[3] += (float) texel->a * (1.0f / 255.0f);
+                }
+                for (float &value : result)
+                {
+                    value *= 0.25f;
+                }
+#endif
+                out[x].r = toSRGB[(int) (result[0] * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+                out[x].g = toSRGB[(int) (result[1] * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+                out[x].b = toSRGB[(int) (result[2] * (SRGB_TABLE_SIZE - 1) + 0.5f)];
+                out[x].a = (uint8_t) (result[3] * 255.0f + 0.5f);
+            }
+        }
     }
 
     static void writeImage(char const *filename, int w, int h, int comp, const void *data, int strideInBytes, bool flipY)
@@ -157,6 +242,50 @@ public:
             dstPixel++;
         }
     }
+
+private:
+    // stb expands grey and rgb to rgba itself, the buffer keeps its allocation
+    static std::shared_ptr<Buffer<RGBA>> adoptRGBA(unsigned char *data, int width, int height)
+    {
+        auto buffer = std::make_shared<Buffer<RGBA>>();
+        buffer->adopt(width, height, std::shared_ptr<RGBA>((RGBA *) data, [](const RGBA *ptr)
+        {
+            stbi_image_free((void *) ptr);
+        }));
+        return buffer;
+    }
+
+    static constexpr int SRGB_TABLE_SIZE = 4096;
+
+    static const float *getSRGBToLinearTable()
+    {
+        static std::vector<float> table = []() -> std::vector<float> {
+            std::vector<float> ret(256);
+            for (int i = 0; i < 256; i++)
+            {
+                float c = (float) i / 255.0f;
+                ret[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return ret;
+        }();
+        return table.data();
+    }
+
+    // indexed by linear value * (SRGB_TABLE_SIZE - 1)
+    static const uint8_t *getLinearToSRGBTable()
+    {
+        static std::vector<uint8_t> table = []() -> std::vector<uint8_t> {
+            std::vector<uint8_t> ret(SRGB_TABLE_SIZE);
+            for (int i = 0; i < SRGB_TABLE_SIZE; i++)
+            {
+                float c = (float) i / (float) (SRGB_TABLE_SIZE - 1);
+                c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                ret[i] = (uint8_t) (glm::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+            }
+            return ret;
+        }();
+        return table.data();
+    }
 };
 
 END_NAMESPACE(GLBase)
@@ -0,0 +1,117 @@
+#ifndef _MAPPED_FILE_HPP_
+#define _MAPPED_FILE_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/Logger.hpp"
+#include "Common/WindowsInc.hpp"
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+BEGIN_NAMESPACE(GLBase)
+
+// Read only view of a whole file, pages are faulted in on access. Unmapped on destruction.
+class MappedFile
+{
+public:
+    explicit MappedFile(const std::string &path)
+    {
+#ifdef _WIN32
+        m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (INVALID_HANDLE_VALUE == m_file)
+        {
+            LOGE("failed to open file: %s", path.c_str());
+            return;
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(m_file, &size) || 0 == size.QuadPart)
+        {
+            LOGE("failed to map file, invalid size: %s", path.c_str());
+            return;
+        }
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (nullptr == m_mapping)
+        {
+            LOGE("failed to map file: %s", path.c_str());
+            return;
+        }
+        m_data = (const uint8_t *) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+        m_size = m_data != nullptr ? (size_t) size.QuadPart : 0;
+#else
+        m_fd = open(path.c_str(), O_RDONLY);
+        if (m_fd < 0)
+        {
+            LOGE("failed to open file: %s", path.c_str());
+            return;
+        }
+        struct stat st{};
+        if (fstat(m_fd, &st) != 0 || st.st_size <= 0)
+        {
+            LOGE("failed to map file, invalid size: %s", path.c_str());
+            return;
+        }
+        void *data = mmap(nullptr, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+        if (MAP_FAILED == data)
+        {
+            LOGE("failed to map file: %s", path.c_str());
+            return;
+        }
+        m_data = (const uint8_t *) data;
+        m_size = (size_t) st.st_size;
+#endif
+    }
+
+    ~MappedFile()
+    {
+#ifdef _WIN32
+        if (m_data != nullptr)
+            UnmapViewOfFile(m_data);
+        if (m_mapping != nullptr)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+#else
+        if (m_data != nullptr)
+            munmap((void *) m_data, m_size);
+        if (m_fd >= 0)
+            close(m_fd);
+#endif
+    }
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    inline bool valid() const
+    {
+        return m_data != nullptr;
+    }
+
+    inline const uint8_t *data() const
+    {
+        return m_data;
+    }
+
+    inline size_t size() const
+    {
+        return m_size;
+    }
+
+private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#else
+    int m_fd = -1;
+#endif
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _MAPPED_FILE_HPP_
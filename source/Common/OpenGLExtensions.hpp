@@ -0,0 +1,302 @@
+#ifndef _OPENGL_EXTENSIONS_HPP_
+#define _OPENGL_EXTENSIONS_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+
+#include "Common/Logger.hpp"
+
+// third_party/glad is generated for GL 3.3 core, entry points from newer versions
+// are declared here and loaded at runtime by OpenGLExtensions::load.
+
+#ifndef GL_VERSION_4_0
+#define GL_DRAW_INDIRECT_BUFFER           0x8F3F
+#endif // GL_VERSION_4_0
+
+#ifndef GL_VERSION_4_1
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#define GL_PROGRAM_BINARY_LENGTH          0x8741
+#define GL_NUM_PROGRAM_BINARY_FORMATS     0x87FE
+
+typedef void (APIENTRYP PFNGLGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void (APIENTRYP PFNGLPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void (APIENTRYP PFNGLPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+
+PFNGLGETPROGRAMBINARYPROC glext_glGetProgramBinary = nullptr;
+PFNGLPROGRAMBINARYPROC glext_glProgramBinary = nullptr;
+PFNGLPROGRAMPARAMETERIPROC glext_glProgramParameteri = nullptr;
+
+#define glGetProgramBinary glext_glGetProgramBinary
+#define glProgramBinary glext_glProgramBinary
+#define glProgramParameteri glext_glProgramParameteri
+#endif // GL_VERSION_4_1
+
+#ifndef GL_VERSION_4_2
+#define GL_COMMAND_BARRIER_BIT            0x00000040
+#define GL_TEXTURE_FETCH_BARRIER_BIT      0x00000008
+#define GL_SHADER_IMAGE_ACCESS_BARRIER_BIT 0x00000020
+#define GL_BUFFER_UPDATE_BARRIER_BIT      0x00000200
+#define GL_FRAMEBUFFER_BARRIER_BIT        0x00000400
+#define GL_ALL_BARRIER_BITS               0xFFFFFFFF
+
+typedef void (APIENTRYP PFNGLBINDIMAGETEXTUREPROC)(GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format);
+typedef void (APIENTRYP PFNGLMEMORYBARRIERPROC)(GLbitfield barriers);
+typedef void (APIENTRYP PFNGLTEXSTORAGE2DPROC)(GLenum target, GLsizei levels, GLenum internalformat, GLsizei width, GLsizei height);
+
+PFNGLBINDIMAGETEXTUREPROC glext_glBindImageTexture = nullptr;
+PFNGLMEMORYBARRIERPROC glext_glMemoryBarrier = nullptr;
+PFNGLTEXSTORAGE2DPROC glext_glTexStorage2D = nullptr;
+
+#define glBindImageTexture glext_glBindImageTexture
+#define glMemoryBarrier glext_glMemoryBarrier
+#define glTexStorage2D glext_glTexStorage2D
+#endif // GL_VERSION_4_2
+
+#ifndef GL_VERSION_4_3
+#define GL_COMPUTE_SHADER                 0x91B9
+#define GL_SHADER_STORAGE_BUFFER          0x90D2
+#define GL_SHADER_STORAGE_BLOCK           0x92E6
+#define GL_SHADER_STORAGE_BARRIER_BIT     0x00002000
+
+typedef void (APIENTRYP PFNGLDISPATCHCOMPUTEPROC)(GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z);
+typedef GLuint (APIENTRYP PFNGLGETPROGRAMRESOURCEINDEXPROC)(GLuint program, GLenum programInterface, const GLchar *name);
+typedef void (APIENTRYP PFNGLSHADERSTORAGEBLOCKBINDINGPROC)(GLuint program, GLuint storageBlockIndex, GLuint storageBlockBinding);
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+typedef void (APIENTRYP PFNGLCLEARBUFFERDATAPROC)(GLenum target, GLenum internalformat, GLenum format, GLenum type, const void *data);
+
+PFNGLDISPATCHCOMPUTEPROC glext_glDispatchCompute = nullptr;
+PFNGLGETPROGRAMRESOURCEINDEXPROC glext_glGetProgramResourceIndex = nullptr;
+PFNGLSHADERSTORAGEBLOCKBINDINGPROC glext_glShaderStorageBlockBinding = nullptr;
+PFNGLMULTIDRAWELEMENTSINDIRECTPROC glext_glMultiDrawElementsIndirect = nullptr;
+PFNGLCLEARBUFFERDATAPROC glext_glClearBufferData = nullptr;
+
+#define glDispatchCompute glext_glDispatchCompute
+#define glGetProgramResourceIndex glext_glGetProgramResourceIndex
+#define glShaderStorageBlockBinding glext_glShaderStorageBlockBinding
+#define glMultiDrawElementsIndirect glext_glMultiDrawElementsIndirect
+#define glClearBufferData glext_glClearBufferData
+#endif // GL_VERSION_4_3
+
+#ifndef GL_VERSION_4_4
+#define GL_MAP_PERSISTENT_BIT             0x0040
+#define GL_MAP_COHERENT_BIT               0x0080
+#define GL_DYNAMIC_STORAGE_BIT            0x0100
+#define GL_CLIENT_STORAGE_BIT             0x0200
+
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+PFNGLBUFFERSTORAGEPROC glext_glBufferStorage = nullptr;
+
+#define glBufferStorage glext_glBufferStorage
+#endif // GL_VERSION_4_4
+
+// EXT_texture_compression_s3tc, BC1 to BC3, the RGTC formats (BC4, BC5) are core since 3.0
+#ifndef GL_EXT_texture_compression_s3tc
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT   0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT  0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT3_EXT  0x83F2
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT  0x83F3
+#endif // GL_EXT_texture_compression_s3tc
+
+// EXT_texture_sRGB, the srgb variants of the S3TC formats
+#ifndef GL_EXT_texture_sRGB
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT  0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif // GL_EXT_texture_sRGB
+
+// KHR_parallel_shader_compile, the ARB variant shares the enums
+#ifndef GL_KHR_parallel_shader_compile
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#define GL_COMPLETION_STATUS_KHR          0x91B1
+
+typedef void (APIENTRYP PFNGLMAXSHADERCOMPILERTHREADSKHRPROC)(GLuint count);
+
+PFNGLMAXSHADERCOMPILERTHREADSKHRPROC glext_glMaxShaderCompilerThreadsKHR = nullptr;
+
+#define glMaxShaderCompilerThreadsKHR glext_glMaxShaderCompilerThreadsKHR
+#endif // GL_KHR_parallel_shader_compile
+
+BEGIN_NAMESPACE(GLBase)
+
+#define GLEXT_LOAD_PROC(name) glext_##name = (decltype(glext_##name))load(#name)
+
+class OpenGLExtensions
+{
+public:
+    static bool load(GLADloadproc load)
+    {
+        GLint major = 0;
+        GLint minor = 0;
+        glGetIntegerv(GL_MAJOR_VERSION, &major);
+        glGetIntegerv(GL_MINOR_VERSION, &minor);
+        s_version = major * 10 + minor;
+
+#ifndef GL_VERSION_4_1
+        GLEXT_LOAD_PROC(glGetProgramBinary);
+        GLEXT_LOAD_PROC(glProgramBinary);
+        GLEXT_LOAD_PROC(glProgramParameteri);
+#endif
+
+#ifndef GL_VERSION_4_2
+        GLEXT_LOAD_PROC(glBindImageTexture);
+        GLEXT_LOAD_PROC(glMemoryBarrier);
+        GLEXT_LOAD_PROC(glTexStorage2D);
+#endif
+
+#ifndef GL_VERSION_4_3
+        GLEXT_LOAD_PROC(glDispatchCompute);
+        GLEXT_LOAD_PROC(glGetProgramResourceIndex);
+        GLEXT_LOAD_PROC(glShaderStorageBlockBinding);
+        GLEXT_LOAD_PROC(glMultiDrawElementsIndirect);
+        GLEXT_LOAD_PROC(glClearBufferData);
+#endif
+
+#ifndef GL_VERSION_4_4
+        GLEXT_LOAD_PROC(glBufferStorage);
+#endif
+
+        s_computeShader = s_version >= 43
+                          && glDispatchCompute != nullptr
+                          && glMemoryBarrier != nullptr
+                          && glBindImageTexture != nullptr
+                          && glShaderStorageBlockBinding != nullptr;
+
+        s_shaderStorageBuffer = s_version >= 43
+                                && glGetProgramResourceIndex != nullptr
+                                && glShaderStorageBlockBinding != nullptr;
+
+        s_indirectDraw = s_computeShader
+                         && s_shaderStorageBuffer
+                         && glMultiDrawElementsIndirect != nullptr
+                         && glClearBufferData != nullptr;
+
+        GLint binaryFormats = 0;
+        if (s_version >= 41)
+        {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binaryFormats);
+        }
+        s_programBinary = binaryFormats > 0
+                          && glGetProgramBinary != nullptr
+                          && glProgramBinary != nullptr
+                          && glProgramParameteri != nullptr;
+
+        s_bufferStorage = (s_version >= 44 || hasExtension("GL_ARB_buffer_storage"))
+                          && glBufferStorage != nullptr;
+
+        s_textureStorage = (s_version >= 42 || hasExtension("GL_ARB_texture_storage"))
+                           && glTexStorage2D != nullptr;
+
+        s_textureCompressionS3TC = hasExtension("GL_EXT_texture_compression_s3tc");
+        s_textureCompressionS3TCSRGB = s_textureCompressionS3TC
+                                       && (hasExtension("GL_EXT_texture_sRGB") || hasExtension("GL_EXT_texture_compression_s3tc_srgb"));
+
+#ifndef GL_KHR_parallel_shader_compile
+        if (hasExtension("GL_KHR_parallel_shader_compile"))
+        {
+            GLEXT_LOAD_PROC(glMaxShaderCompilerThreadsKHR);
+        }
+        else if (hasExtension("GL_ARB_parallel_shader_compile"))
+        {
+            glMaxShaderCompilerThreadsKHR = (PFNGLMAXSHADERCOMPILERTHREADSKHRPROC) load("glMaxShaderCompilerThreadsARB");
+        }
+#endif
+        s_parallelShaderCompile = glMaxShaderCompilerThreadsKHR != nullptr;
+
+        LOGI("OpenGL version: %d.%d, compute shader: %s, parallel shader compile: %s", major, minor,
+             s_computeShader ? "yes" : "no", s_parallelShaderCompile ? "yes" : "no");
+        return true;
+    }
+
+    static int version()
+    {
+        return s_version;
+    }
+
+    static bool hasComputeShader()
+    {
+        return s_computeShader;
+    }
+
+    static bool hasShaderStorageBuffer()
+    {
+        return s_shaderStorageBuffer;
+    }
+
+    static bool hasIndirectDraw()
+    {
+        return s_indirectDraw;
+    }
+
+    static bool hasProgramBinary()
+    {
+        return s_programBinary;
+    }
+
+    static bool hasParallelShaderCompile()
+    {
+        return s_parallelShaderCompile;
+    }
+
+    static bool hasBufferStorage()
+    {
+        return s_bufferStorage;
+    }
+
+    static bool hasTextureStorage()
+    {
+        return s_textureStorage;
+    }
+
+    static bool hasTextureCompressionS3TC()
+    {
+        return s_textureCompressionS3TC;
+    }
+
+    static bool hasTextureCompressionS3TCSRGB()
+    {
+        return s_textureCompressionS3TCSRGB;
+    }
+
+    static bool hasExtension(const char *name)
+    {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+        for (GLint i = 0; i < count; i++)
+        {
+            auto *ext = (const char *) glGetStringi(GL_EXTENSIONS, i);
+            if (ext != nullptr && 0 == strcmp(ext, name))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    static int s_version;
+    static bool s_computeShader;
+    static bool s_shaderStorageBuffer;
+    static bool s_indirectDraw;
+    static bool s_programBinary;
+    static bool s_parallelShaderCompile;
+    static bool s_bufferStorage;
+    static bool s_textureStorage;
+    static bool s_textureCompressionS3TC;
+    static bool s_textureCompressionS3TCSRGB;
+};
+
+int OpenGLExtensions::s_version = 0;
+bool OpenGLExtensions::s_computeShader = false;
+bool OpenGLExtensions::s_shaderStorageBuffer = false;
+bool OpenGLExtensions::s_indirectDraw = false;
+bool OpenGLExtensions::s_programBinary = false;
+bool OpenGLExtensions::s_parallelShaderCompile = false;
+bool OpenGLExtensions::s_bufferStorage = false;
+bool OpenGLExtensions::s_textureStorage = false;
+bool OpenGLExtensions::s_textureCompressionS3TC = false;
+bool OpenGLExtensions::s_textureCompressionS3TCSRGB = false;
+
+END_NAMESPACE(GLBase)
+
+#endif // _OPENGL_EXTENSIONS_HPP_
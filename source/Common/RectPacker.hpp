@@ -0,0 +1,148 @@
+#ifndef _RECT_PACKER_HPP_
+#define _RECT_PACKER_HPP_
+
+#include "Common/cpplang.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Skyline bottom-left packer: the free space is the outline of the placed rects, a new
+// rect goes where its top edge ends lowest, ties prefer the narrower skyline segment.
+class SkylinePacker
+{
+public:
+    SkylinePacker(size_t width, size_t height)
+        : m_width(width), m_height(height)
+    {
+        m_skyline.push_back({0, 0, width});
+    }
+
+    bool insert(size_t width, size_t height, size_t &outX, size_t &outY)
+    {
+        size_t bestIndex = m_skyline.size();
+        size_t bestTop = std::numeric_limits<size_t>::max();
+        size_t bestWidth = std::numeric_limits<size_t>::max();
+        size_t bestY = 0;
+
+        for (size_t i = 0; i < m_skyline.size(); i++)
+        {
+            size_t y = 0;
+            if (!fit(i, width, height, y))
+            {
+                continue;
+            }
+            if (y + height < bestTop || (y + height == bestTop && m_skyline[i].width < bestWidth))
+            {
+                bestIndex = i;
+                bestTop = y + height;
+                bestWidth = m_skyline[i].width;
+                bestY = y;
+            }
+        }
+
+        if (bestIndex == m_skyline.size())
+        {
+            return false;
+        }
+
+        outX = m_skyline[bestIndex].x;
+        outY = bestY;
+        addLevel(bestIndex, outX, outY, width, height);
+
+        m_usedWidth = std::max(m_usedWidth, outX + width);
+        m_usedHeight = std::max(m_usedHeight, outY + height);
+        return true;
+    }
+
+    size_t getUsedWidth() const
+    {
+        return m_usedWidth;
+    }
+
+    size_t getUsedHeight() const
+    {
+        return m_usedHeight;
+    }
+
+private:
+    struct Segment
+    {
+        size_t x;
+        size_t y;
+        size_t width;
+    };
+
+    // y is the highest segment under the rect when its left edge is at segment index
+    bool fit(size_t index, size_t width, size_t height, size_t &y) const
+    {
+        size_t x = m_skyline[index].x;
+        if (x + width > m_width)
+        {
+            return false;
+        }
+
+        y = 0;
+        size_t remaining = width;
+        for (size_t i = index; remaining > 0; i++)
+        {
+            if (i >= m_skyline.size())
+            {
+                return false;
+            }
+            y = std::max(y, m_skyline[i].y);
+            if (y + height > m_height)
+            {
+                return false;
+            }
+            remaining -= std::min(remaining, m_skyline[i].width);
+        }
+        return true;
+    }
+
+    void addLevel(size_t index, size_t x, size_t y, size_t width, size_t height)
+    {
+        m_skyline.insert(m_skyline.begin() + index, {x, y + height, width});
+
+        // trim the segments now under the new one
+        for (size_t i = index + 1; i < m_skyline.size();)
+        {
+            size_t right = x + width;
+            if (m_skyline[i].x >= right)
+            {
+                break;
+            }
+            size_t shrink = right - m_skyline[i].x;
+            if (shrink < m_skyline[i].width)
+            {
+                m_skyline[i].x += shrink;
+                m_skyline[i].width -= shrink;
+                break;
+            }
+            m_skyline.erase(m_skyline.begin() + i);
+        }
+
+        // merge neighbours at the same height
+        for (size_t i = 0; i + 1 < m_skyline.size();)
+        {
+            if (m_skyline[i].y == m_skyline[i + 1].y)
+            {
+                m_skyline[i].width += m_skyline[i + 1].width;
+                m_skyline.erase(m_skyline.begin() + i + 1);
+            }
+            else
+            {
+                i++;
+            }
+        }
+    }
+
+private:
+    size_t m_width;
+    size_t m_height;
+    size_t m_usedWidth = 0;
+    size_t m_usedHeight = 0;
+    std::vector<Segment> m_skyline;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _RECT_PACKER_HPP_
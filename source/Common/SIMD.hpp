@@ -0,0 +1,12 @@
+#ifndef _SIMD_HPP_
+#define _SIMD_HPP_
+
+#include "Common/cpplang.hpp"
+
+// SSE2 is baseline on x86-64, other targets use the scalar paths
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   define SIMD_SSE2
+#   include <emmintrin.h>
+#endif
+
+#endif // _SIMD_HPP_
@@ -18,6 +18,7 @@ public:
     {
         waitTasksFinish();
         m_running = false;
+        m_taskAvailable.notify_all();
         joinThreads();
     }
 
@@ -35,6 +36,7 @@ public:
             std::lock_guard<std::mutex> lock(m_mutex);
             m_tasks.push(std::function<void(size_t)>(task));
         }
+        m_taskAvailable.notify_one();
     }
 
     template<typename F, typename... A>
@@ -45,6 +47,7 @@ public:
 
     void waitTasksFinish() const
     {
+        std::unique_lock<std::mutex> lock(m_mutex);
         while (true)
         {
             if (!paused)
@@ -54,10 +57,11 @@ public:
             }
             else
             {
-                if (tasksRunningCount() == 0)
+                if (m_tasksCount - m_tasks.size() == 0)
                     break;
             }
-            std::this_thread::yield();
+            // paused is not signaled, poll it with a short timeout
+            m_tasksFinished.wait_for(lock, std::chrono::milliseconds(1));
         }
     }
 
@@ -80,21 +84,16 @@ private:
         }
     }
 
-    size_t tasksQueuedCount() const
-    {
-        const std::lock_guard<std::mutex> lock(m_mutex);
-        return m_tasks.size();
-    }
-
-    size_t tasksRunningCount() const
-    {
-        return m_tasksCount - tasksQueuedCount();
-    }
-
     bool popTask(std::function<void(size_t)> &task)
     {
-        const std::lock_guard<std::mutex> lock(m_mutex);
-        if (m_tasks.empty())
+        std::unique_lock<std::mutex> lock(m_mutex);
+        // idle workers sleep instead of spinning, so a pool can be kept alive across frames
+        m_taskAvailable.wait_for(lock, std::chrono::milliseconds(1), [this]
+        {
+            return !m_running || (!paused && !m_tasks.empty());
+        });
+
+        if (paused || m_tasks.empty())
         {
             return false;
         }
@@ -108,20 +107,22 @@ private:
         while(m_running)
         {
             std::function<void(size_t)> task;
-            if (!paused && popTask(task))
+            if (popTask(task))
             {
                 task(threadId);
-                m_tasksCount--;
-            }
-            else
-            {
-                std::this_thread::yield();
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_tasksCount--;
+                }
+                m_tasksFinished.notify_all();
             }
         }
     }
 
 private:
     mutable std::mutex m_mutex{};
+    std::condition_variable m_taskAvailable{};
+    mutable std::condition_variable m_tasksFinished{};
     std::atomic<bool> m_running{true};
     std::unique_ptr<std::thread[]> m_threads;
     std::atomic<size_t> m_threadCount{0};
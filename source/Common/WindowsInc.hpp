@@ -0,0 +1,21 @@
+#ifndef _WINDOWS_INC_HPP_
+#define _WINDOWS_INC_HPP_
+
+#ifdef _WIN32
+
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>
+
+// windef.h defines these empty, they collide with Camera::near() and the clip plane parameters
+#undef near
+#undef far
+
+#endif
+
+#endif // _WINDOWS_INC_HPP_
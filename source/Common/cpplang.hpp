@@ -18,13 +18,16 @@
 #include <unordered_set>
 #include <unordered_map>
 #include <queue>
+#include <deque>
 #include <algorithm>
 #include <functional>
 #include <memory>
 #include <limits>
 #include <thread>
 #include <mutex>
+#include <condition_variable>
 #include <atomic>
+#include <chrono>
 
 // must be C++11 or later
 #if __cplusplus < 201103
@@ -6,6 +6,9 @@
 BEGIN_NAMESPACE(GLBase)
 
 const std::string SHADER_GLSL_DIR = "../source/Shader/GLSL/";
+const std::string SHADER_CACHE_DIR = "./ShaderCache/";
+const std::string TEXTURE_CACHE_DIR = "./TextureCache/";
+const std::string MODEL_CACHE_DIR = "./ModelCache/";
 
 END_NAMESPACE(GLBase)
 
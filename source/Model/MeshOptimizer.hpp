@@ -0,0 +1,267 @@
+#ifndef _MESH_OPTIMIZER_HPP_
+#define _MESH_OPTIMIZER_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/GLMInc.hpp"
+#include "Model/ModelBase.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Load time reordering of triangle lists (Sander et al., "Fast Triangle Reordering for
+// Vertex Locality and Reduced Overdraw"): Tipsify orders triangles for the post transform
+// cache, the clusters between its dead-end jumps are sorted outward facing first to cut
+// overdraw, then vertices are renumbered in first use order so fetches follow the indices.
+class MeshOptimizer
+{
+public:
+    static constexpr size_t CACHE_SIZE = 16;
+
+    // average cache miss ratio, transformed vertices per triangle with a FIFO cache
+    static float computeACMR(const std::vector<int32_t> &indices, size_t vertexCount, size_t cacheSize = CACHE_SIZE)
+    {
+        if (indices.empty())
+        {
+            return 0.0f;
+        }
+
+        std::vector<size_t> timestamps(vertexCount, 0);
+        size_t time = cacheSize + 1;
+        size_t misses = 0;
+        for (int32_t index : indices)
+        {
+            if (time - timestamps[index] > cacheSize)
+            {
+                timestamps[index] = time++;
+                misses++;
+            }
+        }
+        return (float) misses / (float) (indices.size() / 3);
+    }
+
+    static void optimize(std::vector<Vertex> &vertices, std::vector<int32_t> &indices)
+    {
+        if (indices.size() < 3 || vertices.empty())
+        {
+            return;
+        }
+
+        std::vector<size_t> clusters;
+        std::vector<int32_t> ordered = optimizeVertexCache(indices, vertices.size(), clusters);
+        indices = optimizeOverdraw(ordered, vertices, clusters);
+        optimizeVertexFetch(vertices, indices);
+    }
+
+    // clusters receives the first triangle of each run between dead-end jumps
+    static std::vector<int32_t> optimizeVertexCache(const std::vector<int32_t> &indices, size_t vertexCount,
+                                                    std::vector<size_t> &clusters, size_t cacheSize = CACHE_SIZE)
+    {
+        size_t triangleCount = indices.size() / 3;
+
+        // vertex to triangle adjacency
+        std::vector<uint32_t> offsets(vertexCount + 1, 0);
+        for (int32_t index : indices)
+        {
+            offsets[index + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            offsets[v + 1] += offsets[v];
+        }
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+        {
+            adjacency[fill[indices[i]]++] = (uint32_t) (i / 3);
+        }
+
+        std::vector<uint32_t> liveCount(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            liveCount[v] = offsets[v + 1] - offsets[v];
+        }
+
+        std::vector<size_t> timestamps(vertexCount, 0);
+        std::vector<bool> emitted(triangleCount, false);
+        std::vector<int32_t> deadEnd;
+        std::vector<int32_t> candidates;
+        std::vector<int32_t> output;
+        output.reserve(indices.size());
+
+        size_t time = cacheSize + 1;
+        size_t cursor = 0;
+        int32_t fanning = 0;
+        clusters.assign(1, 0);
+        while (fanning >= 0)
+        {
+            candidates.clear();
+            for (uint32_t i = offsets[fanning]; i < offsets[fanning + 1]; i++)
+            {
+                uint32_t triangle = adjacency[i];
+                if (emitted[triangle])
+                {
+                    continue;
+                }
+                for (int k = 0; k < 3; k++)
+                {
+                    int32_t v = indices[triangle * 3 + k];
+                    output.push_back(v);
+                    deadEnd.push_back(v);
+                    candidates.push_back(v);
+                    liveCount[v]--;
+                    if (time - timestamps[v] > cacheSize)
+                    {
+                        timestamps[v] = time++;
+                    }
+                }
+                emitted[triangle] = true;
+            }
+
+            // the candidate that stays in the cache while its remaining triangles are emitted
+            int32_t next = -1;
+            size_t bestPriority = 0;
+            for (int32_t v : candidates)
+            {
+                if (liveCount[v] == 0)
+                {
+                    continue;
+                }
+                size_t priority = 0;
+                if (time - timestamps[v] + 2 * liveCount[v] <= cacheSize)
+                {
+                    priority = time - timestamps[v];
+                }
+                if (next < 0 || priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    next = v;
+                }
+            }
+
+            if (next < 0)
+            {
+                next = skipDeadEnd(liveCount, deadEnd, cursor);
+                if (next >= 0 && output.size() / 3 != clusters.back())
+                {
+                    clusters.push_back(output.size() / 3);
+                }
+            }
+            fanning = next;
+        }
+        return output;
+    }
+
+    // cluster order by how much the cluster faces away from the mesh center, outer ones
+    // first occlude the rest
+    static std::vector<int32_t> optimizeOverdraw(const std::vector<int32_t> &indices, const std::vector<Vertex> &vertices,
+                                                 const std::vector<size_t> &clusters)
+    {
+        size_t triangleCount = indices.size() / 3;
+        if (clusters.size() < 2)
+        {
+            return indices;
+        }
+
+        glm::vec3 meshCenter(0.0f);
+        float meshArea = 0.0f;
+        std::vector<glm::vec3> clusterCenters(clusters.size(), glm::vec3(0.0f));
+        std::vector<glm::vec3> clusterNormals(clusters.size(), glm::vec3(0.0f));
+        std::vector<float> clusterAreas(clusters.size(), 0.0f);
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+            for (size_t t = clusters[c]; t < end; t++)
+            {
+                const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+                const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+                const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+                glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); // length is twice the area
+                float area = glm::length(normal);
+                glm::vec3 center = (p0 + p1 + p2) / 3.0f;
+
+                clusterCenters[c] += center * area;
+                clusterNormals[c] += normal;
+                clusterAreas[c] += area;
+                meshCenter += center * area;
+                meshArea += area;
+            }
+        }
+        if (meshArea > 0.0f)
+        {
+            meshCenter /= meshArea;
+        }
+
+        std::vector<float> sortKeys(clusters.size());
+        for (size_t c = 0; c < clusters.size(); c++)
+        {
+            glm::vec3 center = clusterAreas[c] > 0.0f ? clusterCenters[c] / clusterAreas[c] : clusterCenters[c];
+            float length = glm::length(clusterNormals[c]);
+            glm::vec3 normal = length > 0.0f ? clusterNormals[c] / length : glm::vec3(0.0f);
+            sortKeys[c] = glm::dot(center - meshCenter, normal);
+        }
+
+        std::vector<size_t> order(clusters.size());
+        for (size_t c = 0; c < order.size(); c++)
+        {
+            order[c] = c;
+        }
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return sortKeys[a] > sortKeys[b];
+        });
+
+        std::vector<int32_t> output;
+        output.reserve(indices.size());
+        for (size_t c : order)
+        {
+            size_t end = c + 1 < clusters.size() ? clusters[c + 1] : triangleCount;
+            output.insert(output.end(), indices.begin() + clusters[c] * 3, indices.begin() + end * 3);
+        }
+        return output;
+    }
+
+    // renumbers vertices in first use order, unreferenced ones are dropped
+    static void optimizeVertexFetch(std::vector<Vertex> &vertices, std::vector<int32_t> &indices)
+    {
+        std::vector<int32_t> remap(vertices.size(), -1);
+        std::vector<Vertex> ordered;
+        ordered.reserve(vertices.size());
+        for (auto &index : indices)
+        {
+            if (remap[index] < 0)
+            {
+                remap[index] = (int32_t) ordered.size();
+                ordered.push_back(vertices[index]);
+            }
+            index = remap[index];
+        }
+        vertices = std::move(ordered);
+    }
+
+private:
+    static int32_t skipDeadEnd(const std::vector<uint32_t> &liveCount, std::vector<int32_t> &deadEnd, size_t &cursor)
+    {
+        while (!deadEnd.empty())
+        {
+            int32_t v = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveCount[v] > 0)
+            {
+                return v;
+            }
+        }
+        while (cursor < liveCount.size())
+        {
+            if (liveCount[cursor] > 0)
+            {
+                return (int32_t) cursor;
+            }
+            cursor++;
+        }
+        return -1;
+    }
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _MESH_OPTIMIZER_HPP_
@@ -0,0 +1,135 @@
+#ifndef _MESHLET_BUILDER_HPP_
+#define _MESHLET_BUILDER_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/GLMInc.hpp"
+#include "Model/ModelBase.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Splits a triangle list into meshlets for cluster culling. Triangles are taken greedily in
+// index order, which after MeshOptimizer keeps neighbours together, so each meshlet is a
+// contiguous index range the indirect draw can address directly. Every meshlet gets its
+// bounds and a normal cone for backface rejection of the whole cluster.
+class MeshletBuilder
+{
+public:
+    static constexpr size_t MAX_VERTICES = 64;
+    static constexpr size_t MAX_TRIANGLES = 124;
+
+    static void build(const std::vector<Vertex> &vertices, const std::vector<int32_t> &indices, std::vector<Meshlet> &meshlets,
+                      size_t maxVertices = MAX_VERTICES, size_t maxTriangles = MAX_TRIANGLES)
+    {
+        meshlets.clear();
+        size_t triangleCount = indices.size() / 3;
+        if (triangleCount == 0)
+        {
+            return;
+        }
+
+        // stamp of the meshlet that last used each vertex
+        std::vector<uint32_t> stamps(vertices.size(), 0);
+        uint32_t stamp = 1;
+        size_t first = 0;
+        size_t vertexCount = 0;
+        for (size_t t = 0; t < triangleCount; t++)
+        {
+            const int32_t *tri = &indices[t * 3];
+            size_t newVertices = countNewVertices(tri, stamps, stamp);
+            size_t meshletTriangles = t - first;
+
+            // a triangle sharing no vertex starts a new meshlet once the current one is half
+            // full, the bounds stay tight across the jumps of the cache order
+            bool full = vertexCount + newVertices > maxVertices || meshletTriangles + 1 > maxTriangles;
+            bool detached = newVertices == 3 && meshletTriangles >= maxTriangles / 2;
+            if (meshletTriangles > 0 && (full || detached))
+            {
+                meshlets.push_back(makeMeshlet(vertices, indices, first, t));
+                first = t;
+                vertexCount = 0;
+                stamp++;
+                newVertices = countNewVertices(tri, stamps, stamp);
+            }
+
+            for (int k = 0; k < 3; k++)
+            {
+                stamps[tri[k]] = stamp;
+            }
+            vertexCount += newVertices;
+        }
+        meshlets.push_back(makeMeshlet(vertices, indices, first, triangleCount));
+    }
+
+private:
+    static size_t countNewVertices(const int32_t *tri, const std::vector<uint32_t> &stamps, uint32_t stamp)
+    {
+        size_t count = 0;
+        for (int k = 0; k < 3; k++)
+        {
+            bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+            if (!repeated && stamps[tri[k]] != stamp)
+            {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    static Meshlet makeMeshlet(const std::vector<Vertex> &vertices, const std::vector<int32_t> &indices, size_t first, size_t last)
+    {
+        Meshlet meshlet{};
+        meshlet.firstIndex = (uint32_t) (first * 3);
+        meshlet.indexCount = (uint32_t) ((last - first) * 3);
+        meshlet.boundsMin = glm::vec3(std::numeric_limits<float>::max());
+        meshlet.boundsMax = glm::vec3(-std::numeric_limits<float>::max());
+
+        // face normals from the winding, the same facing the rasterizer culls by
+        std::vector<glm::vec3> normals;
+        normals.reserve(last - first);
+        glm::vec3 axis(0.0f);
+        for (size_t t = first; t < last; t++)
+        {
+            const glm::vec3 &p0 = vertices[indices[t * 3]].position;
+            const glm::vec3 &p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3 &p2 = vertices[indices[t * 3 + 2]].position;
+            meshlet.boundsMin = glm::min(meshlet.boundsMin, glm::min(p0, glm::min(p1, p2)));
+            meshlet.boundsMax = glm::max(meshlet.boundsMax, glm::max(p0, glm::max(p1, p2)));
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(normal);
+            if (length > 0.0f)
+            {
+                normals.push_back(normal / length);
+                axis += normal / length;
+            }
+        }
+
+        meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.coneCutoff = 1.0f;
+        float axisLength = glm::length(axis);
+        if (axisLength <= 0.0f)
+        {
+            return meshlet;
+        }
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (auto &normal : normals)
+        {
+            minDot = std::min(minDot, glm::dot(normal, axis));
+        }
+
+        // a spread of 90 degrees or more faces every direction
+        if (minDot > 0.0f)
+        {
+            meshlet.coneAxis = axis;
+            meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+        }
+        return meshlet;
+    }
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _MESHLET_BUILDER_HPP_
@@ -4,6 +4,7 @@
 #include "Common/cpplang.hpp"
 
 #include "Common/GLMInc.hpp"
+#include "Common/MappedFile.hpp"
 
 #include "Render/Material.hpp"
 #include "Render/Vertex.hpp"
@@ -19,30 +20,282 @@ struct Vertex
     glm::vec3 tangent;
 };
 
+enum class VertexFormat
+{
+    Float32 = 0,        // Vertex as is, 44 bytes
+    Packed,             // half float uvs, octahedral snorm16 normal and tangent, 24 bytes
+    PackedQuantized,    // Packed with unorm16 positions in the mesh bounds, 20 bytes
+};
+
+struct PackedVertex
+{
+    glm::vec3 position;
+    uint32_t texCoords;
+    uint32_t normal;
+    uint32_t tangent;
+};
+
+struct QuantizedVertex
+{
+    uint16_t position[4]; // w is padding
+    uint32_t texCoords;
+    uint32_t normal;
+    uint32_t tangent;
+};
+
+// a run of triangles in the mesh index order, see MeshletBuilder
+struct Meshlet
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    glm::vec3 boundsMin;
+    glm::vec3 boundsMax;
+    glm::vec3 coneAxis;     // average facing of the triangles
+    float coneCutoff;       // sine of the cone spread, 1 when the cone can't cull
+};
+
+// arrays of a cached mesh left in the mapped scene cache file, see SceneCache::load
+struct MappedMeshData
+{
+    std::shared_ptr<MappedFile> file = nullptr;
+    const Vertex *vertices = nullptr;
+    size_t vertexCount = 0;
+    const void *indices = nullptr;
+    size_t indexCount = 0;
+    bool shortIndices = false;
+};
+
 struct ModelBase : VertexArray
 {
     PrimitiveType primitiveType;
     size_t primitiveCount = 0;
     std::vector<Vertex> vertices;
-    std::vector<int32_t> indices;
+    std::vector<int32_t> indices;       // as built, emptied by CompactIndices when every index fits 16 bit
+    std::vector<uint16_t> shortIndices; // the compacted indices, only one of the two is filled
     std::shared_ptr<VertexArrayObject> vao = nullptr;
     std::shared_ptr<Material> material = nullptr;
+    std::vector<Meshlet> meshlets; // empty unless the mesh was split for cluster culling
+    MappedMeshData mapped; // used instead of vertices and indices while file is set
+
+    // gpu copy of vertices in vertexFormat, empty for Float32
+    VertexFormat vertexFormat = VertexFormat::Float32;
+    std::vector<uint8_t> packedVertices;
+    glm::mat4 positionDecode = glm::mat4(1.0f); // quantized positions to mesh space, goes in front of the model matrix
+
+    void InitVertexArray(VertexFormat format = VertexFormat::Float32)
+    {
+        vertexFormat = format;
+        positionDecode = glm::mat4(1.0f);
+        packedVertices.clear();
+
+        const Vertex *src = GetVertices();
+        size_t vertexCount = GetVertexCount();
+        if (VertexFormat::Packed == format)
+        {
+            packedVertices.resize(vertexCount * sizeof(PackedVertex));
+            auto *packed = (PackedVertex *) packedVertices.data();
+            for (size_t i = 0; i < vertexCount; i++)
+            {
+                packed[i].position = src[i].position;
+                packAttributes(src[i], packed[i]);
+            }
+        }
+        else if (VertexFormat::PackedQuantized == format && vertexCount > 0)
+        {
+            glm::vec3 boundsMin = src[0].position;
+            glm::vec3 boundsMax = src[0].position;
+            for (size_t i = 0; i < vertexCount; i++)
+            {
+                boundsMin = glm::min(boundsMin, src[i].position);
+                boundsMax = glm::max(boundsMax, src[i].position);
+            }
+            glm::vec3 extent = glm::max(boundsMax - boundsMin, glm::vec3(1e-6f));
+            positionDecode = glm::scale(glm::translate(glm::mat4(1.0f), boundsMin), extent);
+
+            packedVertices.resize(vertexCount * sizeof(QuantizedVertex));
+            auto *packed = (QuantizedVertex *) packedVertices.data();
+            for (size_t i = 0; i < vertexCount; i++)
+            {
+                glm::vec3 q = glm::clamp((src[i].position - boundsMin) / extent, 0.0f, 1.0f) * 65535.0f + 0.5f;
+                packed[i].position[0] = (uint16_t) q.x;
+                packed[i].position[1] = (uint16_t) q.y;
+                packed[i].position[2] = (uint16_t) q.z;
+                packed[i].position[3] = 0;
+                packAttributes(src[i], packed[i]);
+            }
+        }
+
+        InitVertexLayout();
+    }
+
+    // moves the indices to 16 bit when every one fits, the gpu buffer is uploaded from the same array
+    void CompactIndices()
+    {
+        if (indices.empty())
+        {
+            return;
+        }
+        int32_t maxIndex = *std::max_element(indices.begin(), indices.end());
+        if (maxIndex <= (int32_t) std::numeric_limits<uint16_t>::max())
+        {
+            shortIndices.assign(indices.begin(), indices.end());
+            std::vector<int32_t>().swap(indices);
+        }
+    }
 
-    void InitVertexArray()
+    const Vertex *GetVertices() const
     {
-        vertexSize = sizeof(Vertex);
+        return mapped.file != nullptr ? mapped.vertices : vertices.data();
+    }
 
+    size_t GetVertexCount() const
+    {
+        return mapped.file != nullptr ? mapped.vertexCount : vertices.size();
+    }
+
+    size_t GetIndexCount() const
+    {
+        if (mapped.file != nullptr)
+        {
+            return mapped.indexCount;
+        }
+        return shortIndices.empty() ? indices.size() : shortIndices.size();
+    }
+
+    uint32_t GetIndex(size_t i) const
+    {
+        if (mapped.file != nullptr)
+        {
+            return mapped.shortIndices ? ((const uint16_t *) mapped.indices)[i] : ((const uint32_t *) mapped.indices)[i];
+        }
+        return shortIndices.empty() ? (uint32_t) indices[i] : shortIndices[i];
+    }
+
+    // unmaps a cached mesh once its vao holds the data, nothing is read back on the cpu after that
+    void ReleaseMapping()
+    {
+        if (nullptr == mapped.file)
+        {
+            return;
+        }
+        mapped = MappedMeshData();
+        std::vector<uint8_t>().swap(packedVertices);
+        vertexBuffer = nullptr;
+        vertexBufferLength = 0;
+        indexBuffer = nullptr;
+        indexBufferLength = 0;
+    }
+
+    // copies a mapped cache mesh into vertices and indices, for the meshes that get modified after load
+    void DetachMapping()
+    {
+        if (nullptr == mapped.file)
+        {
+            return;
+        }
+        vertices.assign(mapped.vertices, mapped.vertices + mapped.vertexCount);
+        if (mapped.shortIndices)
+        {
+            auto *src = (const uint16_t *) mapped.indices;
+            shortIndices.assign(src, src + mapped.indexCount);
+        }
+        else
+        {
+            auto *src = (const int32_t *) mapped.indices;
+            indices.assign(src, src + mapped.indexCount);
+        }
+        mapped = MappedMeshData();
+        InitVertexLayout();
+    }
+
+    // attributes for vertexFormat, packedVertices is already filled
+    void InitVertexLayout()
+    {
         attributes.resize(4);
-        attributes[0] = {3, sizeof(Vertex), offsetof(Vertex, position)};
-        attributes[1] = {2, sizeof(Vertex), offsetof(Vertex, texCoords)};
-        attributes[2] = {3, sizeof(Vertex), offsetof(Vertex, normal)};
-        attributes[3] = {3, sizeof(Vertex), offsetof(Vertex, tangent)};
+        switch (vertexFormat)
+        {
+            case VertexFormat::Float32:
+                vertexSize = sizeof(Vertex);
+                attributes[0] = {3, sizeof(Vertex), offsetof(Vertex, position), VertexAttributeType::FLOAT32, false};
+                attributes[1] = {2, sizeof(Vertex), offsetof(Vertex, texCoords), VertexAttributeType::FLOAT32, false};
+                attributes[2] = {3, sizeof(Vertex), offsetof(Vertex, normal), VertexAttributeType::FLOAT32, false};
+                attributes[3] = {3, sizeof(Vertex), offsetof(Vertex, tangent), VertexAttributeType::FLOAT32, false};
+                break;
+            case VertexFormat::Packed:
+                vertexSize = sizeof(PackedVertex);
+                attributes[0] = {3, sizeof(PackedVertex), offsetof(PackedVertex, position), VertexAttributeType::FLOAT32, false};
+                attributes[1] = {2, sizeof(PackedVertex), offsetof(PackedVertex, texCoords), VertexAttributeType::FLOAT16, false};
+                attributes[2] = {2, sizeof(PackedVertex), offsetof(PackedVertex, normal), VertexAttributeType::INT16, true};
+                attributes[3] = {2, sizeof(PackedVertex), offsetof(PackedVertex, tangent), VertexAttributeType::INT16, true};
+                break;
+            case VertexFormat::PackedQuantized:
+                vertexSize = sizeof(QuantizedVertex);
+                attributes[0] = {3, sizeof(QuantizedVertex), offsetof(QuantizedVertex, position), VertexAttributeType::UINT16, true};
+                attributes[1] = {2, sizeof(QuantizedVertex), offsetof(QuantizedVertex, texCoords), VertexAttributeType::FLOAT16, false};
+                attributes[2] = {2, sizeof(QuantizedVertex), offsetof(QuantizedVertex, normal), VertexAttributeType::INT16, true};
+                attributes[3] = {2, sizeof(QuantizedVertex), offsetof(QuantizedVertex, tangent), VertexAttributeType::INT16, true};
+                break;
+        }
+
+        // the gl upload only reads, mapped arrays are passed as they are
+        if (VertexFormat::Float32 == vertexFormat)
+        {
+            vertexBuffer = 0 == GetVertexCount() ? nullptr : (uint8_t *) GetVertices();
+            vertexBufferLength = GetVertexCount() * sizeof(Vertex);
+        }
+        else
+        {
+            vertexBuffer = packedVertices.empty() ? nullptr : &packedVertices[0];
+            vertexBufferLength = packedVertices.size();
+        }
 
-        vertexBuffer = vertices.empty() ? nullptr : (uint8_t *)&vertices[0];
-        vertexBufferLength = vertices.size() * sizeof(Vertex);
+        if (mapped.file != nullptr)
+        {
+            indexType = mapped.shortIndices ? IndexType::UINT16 : IndexType::UINT32;
+            indexBuffer = 0 == mapped.indexCount ? nullptr : (uint8_t *) mapped.indices;
+            indexBufferLength = mapped.indexCount * (mapped.shortIndices ? sizeof(uint16_t) : sizeof(uint32_t));
+            return;
+        }
 
-        indexBuffer = indices.empty() ? nullptr : &indices[0];
-        indexBufferLength = indices.size() * sizeof(int32_t);
+        // merged buffers index per mesh with a base vertex, so they usually fit 16 bit as well
+        CompactIndices();
+        if (!shortIndices.empty())
+        {
+            indexType = IndexType::UINT16;
+            indexBuffer = (uint8_t *) &shortIndices[0];
+            indexBufferLength = shortIndices.size() * sizeof(uint16_t);
+        }
+        else
+        {
+            indexType = IndexType::UINT32;
+            indexBuffer = indices.empty() ? nullptr : (uint8_t *) &indices[0];
+            indexBufferLength = indices.size() * sizeof(int32_t);
+        }
+    }
+
+private:
+    template<typename T>
+    static void packAttributes(const Vertex &vertex, T &packed)
+    {
+        packed.texCoords = glm::packHalf2x16(vertex.texCoords);
+        packed.normal = glm::packSnorm2x16(octEncode(vertex.normal));
+        packed.tangent = glm::packSnorm2x16(octEncode(vertex.tangent));
+    }
+
+    // unit vector to the octahedron unfolded onto [-1, 1]^2, decoded by OctDecode in the shaders
+    static glm::vec2 octEncode(const glm::vec3 &v)
+    {
+        float l1 = std::abs(v.x) + std::abs(v.y) + std::abs(v.z);
+        if (l1 <= 0.0f)
+        {
+            return glm::vec2(0.0f);
+        }
+        glm::vec2 p = glm::vec2(v.x, v.y) / l1;
+        if (v.z < 0.0f)
+        {
+            p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) * glm::vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        return p;
     }
 };
 
@@ -3,6 +3,7 @@
 
 #include "Common/cpplang.hpp"
 
+#include <assimp/DefaultIOSystem.h>
 #include <assimp/GltfMaterial.h>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -13,14 +14,82 @@
 #include "Common/ImageUtils.hpp"
 #include "Common/ThreadPool.hpp"
 #include "Model/Cube.hpp"
+#include "Model/MeshletBuilder.hpp"
+#include "Model/MeshOptimizer.hpp"
 #include "Model/Model.hpp"
+#include "Model/SceneCache.hpp"
+#include "Model/TextureAtlas.hpp"
+#include "Model/TexturePipeline.hpp"
 #include "Render/DemoScene.hpp"
+#include "Render/TextureCompressor.hpp"
 
 BEGIN_NAMESPACE(GLBase)
 
+// Default file access that records every file the importer opens, external buffers and
+// material libraries included, so the scene cache can tell when one of them changed.
+class DependencyIOSystem : public Assimp::DefaultIOSystem
+{
+public:
+    explicit DependencyIOSystem(std::vector<std::string> &files) : m_files(files)
+    {
+    }
+
+    Assimp::IOStream *Open(const char *file, const char *mode = "rb") override
+    {
+        Assimp::IOStream *stream = Assimp::DefaultIOSystem::Open(file, mode);
+        if (stream != nullptr && std::find(m_files.begin(), m_files.end(), file) == m_files.end())
+        {
+            m_files.emplace_back(file);
+        }
+        return stream;
+    }
+
+private:
+    std::vector<std::string> &m_files;
+};
+
 class ModelLoader
 {
 public:
+    // BCn encode material textures after loading, see TextureCompressor
+    void setTextureCompression(bool enabled)
+    {
+        m_textureCompression = enabled;
+    }
+
+    // reorder imported meshes for the vertex cache, overdraw and vertex fetch, see MeshOptimizer
+    void setMeshOptimization(bool enabled)
+    {
+        m_meshOptimization = enabled;
+    }
+
+    // split meshes of at least minTriangles into meshlets for cluster culling, see MeshletBuilder
+    void setMeshlets(bool enabled, size_t minTriangles = 4096)
+    {
+        m_meshlets = enabled;
+        m_meshletMinTriangles = minTriangles;
+    }
+
+    // cap on the encoded and decoded bytes between the texture pipeline stages, see TexturePipeline
+    void setTextureBytesInFlight(size_t bytes)
+    {
+        m_textureBytesInFlight = bytes;
+    }
+
+    // store imported models on disk and load them from there afterwards, see SceneCache
+    void setSceneCache(bool enabled)
+    {
+        m_sceneCache = enabled;
+    }
+
+    // pack textures up to maxTileSize of a loaded model into shared pages, see TextureAtlas
+    void setTextureAtlas(bool enabled, size_t maxTileSize = 256, size_t pageSize = 2048)
+    {
+        m_textureAtlas = enabled;
+        m_atlasMaxTileSize = maxTileSize;
+        m_atlasPageSize = pageSize;
+    }
+
     void loadFloor(ModelMesh &mesh, glm::mat4 transform = glm::mat4(1.0f))
     {
         mesh.vertices.push_back({glm::vec3(25.0f, -0.5f, 25.0f), glm::vec2(25.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f)});
@@ -45,20 +114,23 @@ public:
         mesh.material->baseColor = glm::vec4(1.0f);
 
         std::string texturePath = "../assets/Textures/wood.png";
-        auto buffer = loadTextureFile(texturePath); // create a new buffer and cache
-        if (buffer)
+        auto levels = loadTextureFile(texturePath, true); // create a new mip chain and cache
+        if (!levels.empty())
         {
             auto &texData = mesh.material->textureData[(int)MaterialTexType::ALBEDO];
             texData.tag = texturePath;
-            texData.width = buffer->getWidth();
-            texData.height = buffer->getHeight();
-            texData.data = {buffer};
+            texData.width = levels[0]->getWidth();
+            texData.height = levels[0]->getHeight();
+            texData.data = levels;
+            texData.format = Material::textureFormat(MaterialTexType::ALBEDO);
         }
         else
         {
             LOGE("ModelLoader::loadFloor loadTextureFile failed: %s, path: %s", Material::materialTexTypeStr(MaterialTexType::ALBEDO), texturePath.c_str());
         }
 
+        compressTextures({mesh.material.get()});
+
         mesh.InitVertexArray();
     }
 
@@ -93,23 +165,48 @@ public:
         mesh.material->alphaMode = AlphaMode::Opaque;
 
         std::string texturePath = "../assets/Textures/wood.png";
-        auto buffer = loadTextureFile(texturePath);
-        if (buffer)
+        auto levels = loadTextureFile(texturePath, true);
+        if (!levels.empty())
         {
             auto &texData = mesh.material->textureData[(int)MaterialTexType::ALBEDO];
             texData.tag = texturePath;
-            texData.width = buffer->getWidth();
-            texData.height = buffer->getHeight();
-            texData.data = {buffer};
+            texData.width = levels[0]->getWidth();
+            texData.height = levels[0]->getHeight();
+            texData.data = levels;
+            texData.format = Material::textureFormat(MaterialTexType::ALBEDO);
         }
         else
         {
             LOGE("ModelLoader::loadFloor loadTextureFile failed: %s, path: %s", Material::materialTexTypeStr(MaterialTexType::ALBEDO), texturePath.c_str());
         }
 
+        compressTextures({mesh.material.get()});
+
         mesh.InitVertexArray();
     }
 
+    void loadPointLights(size_t count, float extent, float height, float radius)
+    {
+        m_scene.pointLights.clear();
+        m_scene.pointLights.reserve(count);
+
+        // lay the lights out on a grid above the floor, hue varies per light
+        size_t side = (size_t)std::ceil(std::sqrt((float)count));
+        for (size_t i = 0; i < count; i++)
+        {
+            float u = side > 1 ? (float)(i % side) / (float)(side - 1) : 0.5f;
+            float v = side > 1 ? (float)(i / side) / (float)(side - 1) : 0.5f;
+            float hue = (float)i / (float)count;
+
+            PointLight light{};
+            light.position = glm::vec3((u - 0.5f) * extent, height, (v - 0.5f) * extent);
+            light.radius = radius;
+            light.color = glm::clamp(glm::abs(glm::mod(hue * 6.0f + glm::vec3(0.0f, 4.0f, 2.0f), 6.0f) - 3.0f) - 1.0f, 0.0f, 1.0f);
+            light.intensity = 1.0f;
+            m_scene.pointLights.push_back(light);
+        }
+    }
+
     void loadSkybox(const std::string &filePath)
     {
         if(filePath.empty())
@@ -142,30 +239,91 @@ public:
         m_modelCache[path] = std::make_shared<Model>();
         m_scene.model = m_modelCache[path];
 
+        m_scene.model->resourcePath = path.substr(0, path.find_last_of('/'));
+
+        // the cache holds the model untransformed, the transform is applied after either path
+        const uint32_t importFlags = aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace;
+        uint64_t cacheKey = 0;
+        bool cacheHit = false;
+        if (m_sceneCache)
+        {
+            MappedFile source(path);
+            std::vector<uint32_t> params = {m_meshOptimization ? 1u : 0u, m_meshlets ? 1u : 0u, (uint32_t) m_meshletMinTriangles};
+            cacheKey = SceneCache::makeKey(source.data(), source.size(), m_scene.model->resourcePath, importFlags, params);
+            cacheHit = source.valid() && SceneCache::load(cacheKey, m_scene.model->resourcePath, m_scene.model->rootNode);
+        }
+
+        // texture files stream in while the meshes are converted
+        m_texturePipeline = std::make_shared<TexturePipeline>(std::thread::hardware_concurrency(), m_textureBytesInFlight, m_textureContentCache);
+        bool loaded = true;
+        if (cacheHit)
+        {
+            loadCachedMeshes(m_scene.model->rootNode);
+        }
+        else
+        {
+            loaded = importModel(path, importFlags, cacheKey);
+        }
+        m_texturePipeline = nullptr;
+        if (!loaded)
+        {
+            return false;
+        }
+
+        applyTransform(m_scene.model->rootNode, transform);
+
+        if (m_textureAtlas)
+        {
+            std::vector<ModelMesh *> meshes;
+            collectMeshes(m_scene.model->rootNode, meshes);
+            size_t pageCount = TextureAtlas::build(meshes, m_atlasMaxTileSize, m_atlasPageSize);
+            if (pageCount > 0)
+            {
+                LOGI("ModelLoader::loadModel, texture atlas pages: %d", pageCount);
+            }
+        }
+
+        std::vector<Material *> materials;
+        collectMaterials(m_scene.model->rootNode, materials);
+        compressTextures(materials);
+
+        return true;
+    }
+
+    bool importModel(const std::string &path, uint32_t importFlags, uint64_t cacheKey)
+    {
+        // the importer owns the io system, the files it opened become cache dependencies
+        std::vector<std::string> dependencies;
         Assimp::Importer importer;
-        aiScene const *scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        importer.SetIOHandler(new DependencyIOSystem(dependencies));
+        aiScene const *scene = importer.ReadFile(path, importFlags);
         if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
         {
             LOGE("Assimp error: %s", importer.GetErrorString());
             return false;
         }
 
-        m_scene.model->resourcePath = path.substr(0, path.find_last_of('/'));
-
         preloadTextureFiles(scene, m_scene.model->resourcePath);
 
-        if (!processNode(scene->mRootNode, scene, m_scene.model->rootNode, transform))
+        glm::mat4 identity(1.0f);
+        if (!processNode(scene->mRootNode, scene, m_scene.model->rootNode, identity))
         {
             LOGE("ModelLoader::loadModel, process node failed.");
             return false;
         }
 
+        dependencies.erase(std::remove(dependencies.begin(), dependencies.end(), path), dependencies.end());
+        if (m_sceneCache && !SceneCache::store(cacheKey, m_scene.model->resourcePath, dependencies, m_scene.model->rootNode))
+        {
+            LOGW("ModelLoader::loadModel, scene cache store failed: %s", path.c_str());
+        }
         return true;
     }
 
+    // queues the images on the texture pipeline, loadTextureFile picks them up
     void preloadTextureFiles(const aiScene *scene, const std::string &resDir)
     {
-        std::set<std::string> texPaths;
+        std::set<std::pair<std::string, bool>> texPaths; // path, srgb
 		for (int materialIdx = 0; materialIdx < scene->mNumMaterials; materialIdx++)
         {
 			aiMaterial* material = scene->mMaterials[materialIdx];
@@ -181,50 +339,251 @@ public:
                     {
 						continue;
 					}
-					texPaths.insert(resDir + "/" + textPath.C_Str());
+					texPaths.insert({resDir + "/" + textPath.C_Str(), isColorTexture(textureType)});
 				}
 			}
 		}
-		if (texPaths.empty())
+        preloadTextureFiles(texPaths);
+    }
+
+    void preloadTextureFiles(const std::set<std::pair<std::string, bool>> &texPaths)
+    {
+        TextureContentCache::MipChain levels;
+        for (auto &texPath : texPaths)
         {
-			return;
-		}
+            if (!m_textureDataCache.find(texPath, levels))
+            {
+                m_texturePipeline->request(texPath.first, texPath.second);
+            }
+        }
+    }
+
+    // cached meshes come with texture paths only, the images go through the same caches as an import
+    void loadCachedMeshes(ModelNode &root)
+    {
+        std::vector<ModelMesh *> meshes;
+        collectMeshes(root, meshes);
+
+        std::set<std::pair<std::string, bool>> texPaths; // path, srgb
+        for (auto *mesh : meshes)
+        {
+            for (auto &kv : mesh->material->textureData)
+            {
+                texPaths.insert({kv.second.tag, isColorTexture((MaterialTexType) kv.first)});
+            }
+        }
+        preloadTextureFiles(texPaths);
+
+        for (auto *mesh : meshes)
+        {
+            auto &textureData = mesh->material->textureData;
+            for (auto it = textureData.begin(); it != textureData.end();)
+            {
+                auto levels = loadTextureFile(it->second.tag, isColorTexture((MaterialTexType) it->first));
+                if (levels.empty())
+                {
+                    LOGE("load texture failed: %s, path: %s", Material::materialTexTypeStr((MaterialTexType) it->first), it->second.tag.c_str());
+                    it = textureData.erase(it);
+                    continue;
+                }
+                it->second.width = levels[0]->getWidth();
+                it->second.height = levels[0]->getHeight();
+                it->second.data = levels;
+                ++it;
+            }
+
+            LOGI("vertex count: %d, index count: %d", mesh->GetVertexCount(), mesh->GetIndexCount());
+            mesh->InitVertexArray();
+        }
+    }
+
+    void applyTransform(ModelNode &node, const glm::mat4 &transform)
+    {
+        node.transform = transform * node.transform;
+        for (auto &child : node.children)
+        {
+            applyTransform(child, transform);
+        }
+    }
+
+    static bool isColorTexture(aiTextureType type)
+    {
+        return aiTextureType_BASE_COLOR == type || aiTextureType_DIFFUSE == type || aiTextureType_EMISSIVE == type;
+    }
+
+    static bool isColorTexture(MaterialTexType type)
+    {
+        return MaterialTexType::ALBEDO == type || MaterialTexType::EMISSIVE == type;
+    }
+
+    // one worker per distinct image and format, materials sharing an image share the result
+    void compressTextures(const std::vector<Material *> &materials)
+    {
+        if (!m_textureCompression)
+        {
+            return;
+        }
+
+        using CompressKey = std::pair<const Buffer<RGBA> *, TextureFormat>;
+        std::map<CompressKey, std::shared_ptr<CompressedImage>> compressed;
+        std::vector<std::pair<TextureData *, CompressKey>> targets;
+        struct CompressJob
+        {
+            CompressKey key;
+            std::vector<std::shared_ptr<Buffer<RGBA>>> levels;
+            bool srgb;
+        };
+        std::vector<CompressJob> jobs;
+        for (auto *material : materials)
+        {
+            for (auto &kv : material->textureData)
+            {
+                if (kv.second.data.empty() || kv.second.compressed != nullptr)
+                {
+                    continue;
+                }
+
+                auto &buffer = kv.second.data[0];
+                TextureFormat format = TextureCompressor::selectFormat((MaterialTexType) kv.first, *buffer);
+                if (TextureFormat::RGBA8 == format)
+                {
+                    continue;
+                }
+
+                // entries of released images expire, their address may be reused by a new one
+                CompressKey key(buffer.get(), format);
+                if (compressed.find(key) == compressed.end())
+                {
+                    auto cached = m_compressedCache.find(key);
+                    auto image = cached != m_compressedCache.end() && cached->second.source.lock() == buffer ? cached->second.image.lock() : nullptr;
+                    compressed[key] = image;
+                    if (nullptr == image)
+                    {
+                        jobs.push_back({key, kv.second.data, isColorTexture((MaterialTexType) kv.first)});
+                    }
+                }
+                targets.emplace_back(&kv.second, key);
+            }
+        }
 
-        ThreadPool pool(std::min(texPaths.size(), (size_t)std::thread::hardware_concurrency()));
-        for(auto &path : texPaths)
+        if (!jobs.empty())
         {
-            pool.pushTask([&](int thread_id)
+            std::vector<std::shared_ptr<CompressedImage>> results(jobs.size());
             {
-                loadTextureFile(path);
-            });
+                ThreadPool pool(std::min(jobs.size(), (size_t) std::thread::hardware_concurrency()));
+                for (size_t i = 0; i < jobs.size(); i++)
+                {
+                    pool.pushTask([&, i](size_t threadId)
+                                  {
+                                      results[i] = TextureCompressor::compress(jobs[i].levels, jobs[i].key.second, jobs[i].srgb);
+                                  });
+                }
+            }
+
+            // entries of released images could never hit again, their keys may even be reused
+            for (auto it = m_compressedCache.begin(); it != m_compressedCache.end();)
+            {
+                it = it->second.source.expired() || it->second.image.expired() ? m_compressedCache.erase(it) : std::next(it);
+            }
+            for (size_t i = 0; i < jobs.size(); i++)
+            {
+                compressed[jobs[i].key] = results[i];
+                m_compressedCache[jobs[i].key] = {jobs[i].levels[0], results[i]};
+            }
+        }
+
+        for (auto &target : targets)
+        {
+            target.first->compressed = compressed[target.second];
         }
     }
 
-    std::shared_ptr<Buffer<RGBA>> loadTextureFile(const std::string &path)
+    // the decoded image with its full mip chain, srgb filters the color channels in linear space
+    std::vector<std::shared_ptr<Buffer<RGBA>>> loadTextureFile(const std::string &path, bool srgb)
     {
-        m_texCacheMutex.lock();
-        if (m_textureDataCache.find(path) != m_textureDataCache.end())
+        TexturePipeline::MipChain levels;
+        if (m_textureDataCache.find({path, srgb}, levels))
         {
-            m_texCacheMutex.unlock();
-            return m_textureDataCache[path];
+            return levels;
         }
-        m_texCacheMutex.unlock();
 
-        auto buffer = ImageUtils::readImageRGBA(path);
-        if (nullptr == buffer)
+        // queued files come out of the pipeline, anything else is decoded here
+        if (m_texturePipeline != nullptr && m_texturePipeline->wait(path, srgb, levels))
         {
-            LOGE("ModelLoader::loadTextureFile, failed to load texture with path: %s", path.c_str());
-            return nullptr;
+            if (levels.empty())
+            {
+                LOGE("ModelLoader::loadTextureFile, failed to load texture with path: %s", path.c_str());
+                return {};
+            }
+            m_textureDataCache.insert({path, srgb}, levels);
+            return levels;
         }
 
-        m_texCacheMutex.lock();
-        m_textureDataCache[path] = buffer;
-        m_texCacheMutex.unlock();
+        // the same image under another name shares its mip chain
+        auto bytes = FileUtils::readBytes(path);
+        uint64_t contentKey = TextureContentCache::makeKey(bytes, srgb);
+        if (!m_textureContentCache.find(contentKey, levels))
+        {
+            auto buffer = bytes.empty() ? nullptr : ImageUtils::readImageRGBA(bytes.data(), bytes.size(), path);
+            if (nullptr == buffer)
+            {
+                LOGE("ModelLoader::loadTextureFile, failed to load texture with path: %s", path.c_str());
+                return {};
+            }
+            levels = ImageUtils::generateMipmaps(buffer, srgb);
+            m_textureContentCache.insert(contentKey, levels);
+        }
 
-        return buffer;
+        m_textureDataCache.insert({path, srgb}, levels);
+        return levels;
     }
 
+    // the tree is built on the calling thread, then every mesh is converted by its own worker
     bool processNode(aiNode *ai_node, const aiScene *ai_scene, ModelNode &outNode, glm::mat4 &transform)
+    {
+        std::vector<const aiMesh *> sources;
+        if (!buildNode(ai_node, ai_scene, outNode, transform, sources))
+        {
+            return false;
+        }
+
+        std::vector<ModelMesh *> meshes;
+        collectMeshes(outNode, meshes);
+        if (meshes.empty())
+        {
+            return true;
+        }
+
+        std::vector<char> results(meshes.size(), 0);
+        {
+            ThreadPool pool(std::min(meshes.size(), (size_t) std::thread::hardware_concurrency()));
+            for (size_t i = 0; i < meshes.size(); i++)
+            {
+                pool.pushTask([&, i](size_t threadId)
+                              {
+                                  results[i] = processMesh(sources[i], ai_scene, *meshes[i]) ? 1 : 0;
+                              });
+            }
+        }
+
+        std::unordered_set<const ModelMesh *> failed;
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            if (!results[i])
+            {
+                failed.insert(meshes[i]);
+            }
+        }
+        if (!failed.empty())
+        {
+            removeMeshes(outNode, failed);
+        }
+
+        return true;
+    }
+
+    // sources receives the meshes in the order collectMeshes visits them
+    bool buildNode(aiNode *ai_node, const aiScene *ai_scene, ModelNode &outNode, glm::mat4 &transform, std::vector<const aiMesh *> &sources)
     {
         if (nullptr == ai_node)
         {
@@ -238,83 +597,84 @@ public:
 			const aiMesh* meshPtr = ai_scene->mMeshes[ai_node->mMeshes[i]];
             if (meshPtr != nullptr)
             {
-                ModelMesh mesh;
-                if (processMesh(meshPtr, ai_scene, mesh))
-                {
-                    outNode.meshes.push_back(std::move(mesh));
-                }
+                outNode.meshes.emplace_back();
+                sources.push_back(meshPtr);
             }
         }
 
+        // children are moved into place before their meshes are collected
+        std::vector<const aiMesh *> childSources;
         for (size_t i = 0; i < ai_node->mNumChildren; i++)
         {
 			ModelNode childNode;
-			if (processNode(ai_node->mChildren[i], ai_scene, childNode, outNode.transform))
+			if (buildNode(ai_node->mChildren[i], ai_scene, childNode, outNode.transform, childSources))
             {
 				outNode.children.push_back(std::move(childNode));
 			}
 		}
+        sources.insert(sources.end(), childSources.begin(), childSources.end());
 
         return true;
     }
 
+    void removeMeshes(ModelNode &node, const std::unordered_set<const ModelMesh *> &meshes)
+    {
+        node.meshes.erase(std::remove_if(node.meshes.begin(), node.meshes.end(), [&](const ModelMesh &mesh)
+        {
+            return meshes.count(&mesh) > 0;
+        }), node.meshes.end());
+        for (auto &child : node.children)
+        {
+            removeMeshes(child, meshes);
+        }
+    }
+
+    // called on worker threads, one per mesh
     bool processMesh(const aiMesh* ai_mesh, const aiScene* ai_scene, ModelMesh& outMesh)
     {
-	    std::vector<Vertex> vertices;
-		std::vector<int> indices;
-        for (size_t i = 0; i < ai_mesh->mNumVertices; i++)
+        // one pass per attribute, missing ones stay zero
+        std::vector<Vertex> vertices(ai_mesh->mNumVertices, Vertex{});
+        if (ai_mesh->HasPositions())
         {
-			Vertex vertex{};
-			if (ai_mesh->HasPositions())
-            {
-				vertex.position.x = ai_mesh->mVertices[i].x;
-				vertex.position.y = ai_mesh->mVertices[i].y;
-				vertex.position.z = ai_mesh->mVertices[i].z;
-			}
-			if (ai_mesh->HasTextureCoords(0))
-            {
-				vertex.texCoords.x = ai_mesh->mTextureCoords[0][i].x;
-				vertex.texCoords.y = ai_mesh->mTextureCoords[0][i].y;
-			}
-            else
-            {
-				vertex.texCoords = glm::vec2(0.0f, 0.0f);
-			}
-			if (ai_mesh->HasNormals())
+            for (size_t i = 0; i < vertices.size(); i++)
             {
-				vertex.normal.x = ai_mesh->mNormals[i].x;
-				vertex.normal.y = ai_mesh->mNormals[i].y;
-				vertex.normal.z = ai_mesh->mNormals[i].z;
-			}
-            else
+                vertices[i].position = glm::vec3(ai_mesh->mVertices[i].x, ai_mesh->mVertices[i].y, ai_mesh->mVertices[i].z);
+            }
+        }
+        if (ai_mesh->HasTextureCoords(0))
+        {
+            for (size_t i = 0; i < vertices.size(); i++)
             {
-                vertex.normal = glm::vec3(0.0f, 0.0f, 0.0f);
+                vertices[i].texCoords = glm::vec2(ai_mesh->mTextureCoords[0][i].x, ai_mesh->mTextureCoords[0][i].y);
             }
-			if (ai_mesh->HasTangentsAndBitangents())
+        }
+        if (ai_mesh->HasNormals())
+        {
+            for (size_t i = 0; i < vertices.size(); i++)
             {
-				vertex.tangent.x = ai_mesh->mTangents[i].x;
-				vertex.tangent.y = ai_mesh->mTangents[i].y;
-				vertex.tangent.z = ai_mesh->mTangents[i].z;
-			}
-            else
+                vertices[i].normal = glm::vec3(ai_mesh->mNormals[i].x, ai_mesh->mNormals[i].y, ai_mesh->mNormals[i].z);
+            }
+        }
+        if (ai_mesh->HasTangentsAndBitangents())
+        {
+            for (size_t i = 0; i < vertices.size(); i++)
             {
-                vertex.tangent = glm::vec3(0.0f, 0.0f, 0.0f);
+                vertices[i].tangent = glm::vec3(ai_mesh->mTangents[i].x, ai_mesh->mTangents[i].y, ai_mesh->mTangents[i].z);
             }
-			vertices.push_back(vertex);
-		}
+        }
 
+        std::vector<int> indices(ai_mesh->mNumFaces * 3);
         for (size_t i = 0; i < ai_mesh->mNumFaces; i++)
         {
-			aiFace face = ai_mesh->mFaces[i];
+			const aiFace &face = ai_mesh->mFaces[i];
 			if (face.mNumIndices != 3)
             {
 				LOGE("ModelLoader::processMesh, mesh not transformed to triangle mesh.");
 				return false;
 			}
-			for (size_t j = 0; j < face.mNumIndices; ++j)
-            {
-				indices.push_back((int)(face.mIndices[j]));
-			}
+            indices[i * 3 + 0] = (int) face.mIndices[0];
+            indices[i * 3 + 1] = (int) face.mIndices[1];
+            indices[i * 3 + 2] = (int) face.mIndices[2];
 		}
 
         outMesh.material = std::make_shared<Material>();
@@ -358,10 +718,24 @@ public:
 			}
         }
 
+        if (m_meshOptimization)
+        {
+            float acmrBefore = MeshOptimizer::computeACMR(indices, vertices.size());
+            MeshOptimizer::optimize(vertices, indices);
+            LOGI("mesh optimized, ACMR: %.3f -> %.3f", acmrBefore, MeshOptimizer::computeACMR(indices, vertices.size()));
+        }
+
+        if (m_meshlets && indices.size() / 3 >= m_meshletMinTriangles)
+        {
+            MeshletBuilder::build(vertices, indices, outMesh.meshlets);
+            LOGI("mesh split into %zu meshlets", outMesh.meshlets.size());
+        }
+
         outMesh.vertices = std::move(vertices);
         outMesh.indices = std::move(indices);
+        outMesh.CompactIndices();
 
-        LOGI("vertex count: %d, index count: %d", outMesh.vertices.size(), outMesh.indices.size());
+        LOGI("vertex count: %d, index count: %d", outMesh.vertices.size(), outMesh.GetIndexCount());
 
         outMesh.InitVertexArray();
 
@@ -411,14 +785,15 @@ public:
 				continue; // not support
 			}
 
-            auto buffer = loadTextureFile(absolutePath);
-			if (buffer)
+            auto levels = loadTextureFile(absolutePath, isColorTexture(ai_texType));
+			if (!levels.empty())
             {
 				auto& texData = outMaterial.textureData[(int)texType];
 				texData.tag = absolutePath;
-				texData.width = buffer->getWidth();
-				texData.height = buffer->getHeight();
-				texData.data = {buffer};
+				texData.width = levels[0]->getWidth();
+				texData.height = levels[0]->getHeight();
+				texData.data = levels;
+				texData.format = Material::textureFormat(texType);
 			}
             else
             {
@@ -432,6 +807,34 @@ public:
         return m_scene;
     }
 
+    // merged atlas materials show up once
+    void collectMaterials(ModelNode &node, std::vector<Material *> &materials)
+    {
+        for (auto &mesh : node.meshes)
+        {
+            if (mesh.material != nullptr && std::find(materials.begin(), materials.end(), mesh.material.get()) == materials.end())
+            {
+                materials.push_back(mesh.material.get());
+            }
+        }
+        for (auto &child : node.children)
+        {
+            collectMaterials(child, materials);
+        }
+    }
+
+    void collectMeshes(ModelNode &node, std::vector<ModelMesh *> &meshes)
+    {
+        for (auto &mesh : node.meshes)
+        {
+            meshes.push_back(&mesh);
+        }
+        for (auto &child : node.children)
+        {
+            collectMeshes(child, meshes);
+        }
+    }
+
     glm::mat4 convertMatrix(const aiMatrix4x4& m)
     {
 		glm::mat4 ret;
@@ -446,11 +849,28 @@ public:
 	}
 
 private:
+    struct CompressedEntry
+    {
+        std::weak_ptr<Buffer<RGBA>> source;
+        std::weak_ptr<CompressedImage> image;
+    };
+
     DemoScene m_scene;
     std::unordered_map<std::string, std::shared_ptr<Model>> m_modelCache;
-    std::unordered_map<std::string, std::shared_ptr<Buffer<RGBA>>> m_textureDataCache;
+    MipChainCache<std::pair<std::string, bool>> m_textureDataCache; // mip chains by path and srgb
+    TextureContentCache m_textureContentCache; // mip chains by file content
+    std::map<std::pair<const Buffer<RGBA> *, TextureFormat>, CompressedEntry> m_compressedCache;
+    bool m_textureCompression = true;
+    bool m_sceneCache = true;
+    bool m_meshOptimization = true;
+    bool m_meshlets = true;
+    size_t m_meshletMinTriangles = 4096;
+    bool m_textureAtlas = true;
+    size_t m_atlasMaxTileSize = 256;
+    size_t m_atlasPageSize = 2048;
     std::mutex m_modelLoadMutex;
-    std::mutex m_texCacheMutex;
+    std::shared_ptr<TexturePipeline> m_texturePipeline = nullptr;
+    size_t m_textureBytesInFlight = 256 * 1024 * 1024;
 };
 
 END_NAMESPACE(GLBase)
@@ -0,0 +1,418 @@
+#ifndef _SCENE_CACHE_HPP_
+#define _SCENE_CACHE_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/DiskCache.hpp"
+#include "Common/FileUtils.hpp"
+#include "Common/HashUtils.hpp"
+#include "Common/Logger.hpp"
+#include "Common/MappedFile.hpp"
+#include "Config/Config.hpp"
+#include "Model/Model.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// bump when the file layout or the mesh processing baked into it change
+const uint32_t SCENE_CACHE_VERSION = 4;
+
+// Imported models stored on disk after their first load: the node hierarchy in pre-order,
+// each mesh's processed vertices, 16 or 32 bit indices and meshlets, its material parameters
+// and the paths of its textures relative to the model directory. The key covers the source
+// file and the import settings, the other files the importer read (external buffers,
+// material libraries) are listed with their content hash and checked on load, a hit skips
+// Assimp entirely. Texture pixels are not stored, the loader reads them through its texture
+// caches. The file is mapped and every array starts aligned in its final layout, the meshes
+// draw straight from the mapped pages and copy out only what they modify after the load.
+class SceneCache
+{
+public:
+    // params are the loader settings that change the processed meshes. The same source in
+    // another directory resolves other dependencies and textures, so it gets an entry of its own
+    static uint64_t makeKey(const uint8_t *source, size_t sourceSize, const std::string &resourcePath, uint32_t importFlags,
+                            const std::vector<uint32_t> &params)
+    {
+        uint32_t header[2] = {SCENE_CACHE_VERSION, importFlags};
+        uint64_t key = HashUtils::hashBytes(header, sizeof(header));
+        std::string directory = FileUtils::canonicalPath(resourcePath);
+        key = HashUtils::hashBytes(directory.data(), directory.size(), key);
+        if (!params.empty())
+        {
+            key = HashUtils::hashBytes(params.data(), params.size() * sizeof(uint32_t), key);
+        }
+        return HashUtils::hashBytes(source, sourceSize, key);
+    }
+
+    // textures are listed with their path in tag, the pixels are left to the caller. The vertices
+    // and indices stay in the mapping, which lives until every mesh released it
+    static bool load(uint64_t key, const std::string &resourcePath, ModelNode &root)
+    {
+        auto &cache = diskCache();
+        std::string path = cache.getPath(key);
+        if (!FileUtils::exists(path))
+        {
+            return false;
+        }
+
+        auto file = std::make_shared<MappedFile>(path);
+        if (!cache.checkHeader(file->data(), file->size(), key))
+        {
+            return false;
+        }
+
+        Reader reader{file->data(), file->size(), DiskCache::HEADER_SIZE};
+        std::string dependency;
+        if (!checkDependencies(reader, resourcePath, dependency))
+        {
+            LOGW("scene cache stale, dependency changed: %s", dependency.c_str());
+            return false;
+        }
+        if (!readNode(reader, resourcePath, file, root) || reader.offset != file->size())
+        {
+            LOGW("scene cache truncated: %s", path.c_str());
+            root = ModelNode();
+            return false;
+        }
+
+        LOGD("scene cache hit: %s", path.c_str());
+        return true;
+    }
+
+    // dependencies are the files besides the source the import read
+    static bool store(uint64_t key, const std::string &resourcePath, const std::vector<std::string> &dependencies, const ModelNode &root)
+    {
+        std::vector<uint8_t> data;
+        diskCache().writeHeader(data, key);
+        if (!writeDependencies(data, resourcePath, dependencies))
+        {
+            return false;
+        }
+        writeNode(data, resourcePath, root);
+        return diskCache().write(key, data);
+    }
+
+private:
+    struct MaterialHeader
+    {
+        uint32_t shadingModel;
+        uint32_t alphaMode;
+        uint32_t doubleSided;
+        uint32_t textureCount;
+        glm::vec4 baseColor;
+    };
+
+    struct DependencyHeader
+    {
+        uint64_t size;
+        uint64_t hash;
+        uint32_t pathLength;
+        uint32_t reserved;
+    };
+
+    struct TextureHeader
+    {
+        uint32_t type;
+        uint32_t format;
+        uint32_t wrapMode[3];
+        uint32_t pathLength;
+    };
+
+    struct Reader
+    {
+        const uint8_t *data;
+        size_t size;
+        size_t offset;
+
+        bool read(void *dst, size_t length)
+        {
+            if (offset + length > size)
+            {
+                return false;
+            }
+            memcpy(dst, data + offset, length);
+            offset += length;
+            return true;
+        }
+
+        // the array where it lies in the mapping
+        template<typename T>
+        bool readSection(const T *&dst, size_t &count)
+        {
+            uint32_t length32 = 0;
+            if (!read(&length32, sizeof(length32)))
+            {
+                return false;
+            }
+            offset = alignOffset(offset);
+            size_t length = (size_t) length32 * sizeof(T);
+            if (offset + length > size)
+            {
+                return false;
+            }
+            dst = (const T *) (data + offset);
+            count = length32;
+            offset += length;
+            return true;
+        }
+
+        template<typename T>
+        bool readArray(std::vector<T> &dst)
+        {
+            const T *src = nullptr;
+            size_t count = 0;
+            if (!readSection(src, count))
+            {
+                return false;
+            }
+            dst.assign(src, src + count);
+            return true;
+        }
+    };
+
+    static constexpr uint32_t CACHE_FILE_MAGIC = 0x4e435347; // "GSCN"
+
+    static const DiskCache &diskCache()
+    {
+        static const DiskCache cache(MODEL_CACHE_DIR, "bsc", CACHE_FILE_MAGIC, SCENE_CACHE_VERSION, "scene cache");
+        return cache;
+    }
+
+    static constexpr size_t SECTION_ALIGNMENT = 16;
+
+    static size_t alignOffset(size_t offset)
+    {
+        return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+    }
+
+    static void write(std::vector<uint8_t> &data, const void *src, size_t length)
+    {
+        data.insert(data.end(), (const uint8_t *) src, (const uint8_t *) src + length);
+    }
+
+    template<typename T>
+    static void writeArray(std::vector<uint8_t> &data, const std::vector<T> &src)
+    {
+        auto count = (uint32_t) src.size();
+        write(data, &count, sizeof(count));
+        data.resize(alignOffset(data.size()), 0);
+        write(data, src.data(), src.size() * sizeof(T));
+    }
+
+    static bool hashFile(const std::string &path, DependencyHeader &header)
+    {
+        MappedFile file(path);
+        if (!file.valid())
+        {
+            return false;
+        }
+        header.size = file.size();
+        header.hash = HashUtils::hashContent(file.data(), file.size());
+        return true;
+    }
+
+    static bool writeDependencies(std::vector<uint8_t> &data, const std::string &resourcePath, const std::vector<std::string> &dependencies)
+    {
+        auto count = (uint32_t) dependencies.size();
+        write(data, &count, sizeof(count));
+        for (auto &dependency : dependencies)
+        {
+            DependencyHeader header{};
+            if (!hashFile(dependency, header))
+            {
+                LOGE("scene cache read dependency failed: %s", dependency.c_str());
+                return false;
+            }
+            std::string relPath = relativePath(resourcePath, dependency);
+            header.pathLength = (uint32_t) relPath.length();
+            write(data, &header, sizeof(DependencyHeader));
+            write(data, relPath.data(), relPath.length());
+        }
+        return true;
+    }
+
+    // false on the first dependency that is missing or has other content, its path in changed
+    static bool checkDependencies(Reader &reader, const std::string &resourcePath, std::string &changed)
+    {
+        uint32_t count = 0;
+        if (!reader.read(&count, sizeof(count)))
+        {
+            return false;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            DependencyHeader header{};
+            if (!reader.read(&header, sizeof(DependencyHeader)))
+            {
+                return false;
+            }
+            std::string relPath(header.pathLength, '\0');
+            if (header.pathLength > 0 && !reader.read(&relPath[0], header.pathLength))
+            {
+                return false;
+            }
+
+            changed = resolvePath(resourcePath, relPath);
+            DependencyHeader current{};
+            if (!hashFile(changed, current) || current.size != header.size || current.hash != header.hash)
+            {
+                return false;
+            }
+        }
+        changed.clear();
+        return true;
+    }
+
+    static void writeNode(std::vector<uint8_t> &data, const std::string &resourcePath, const ModelNode &node)
+    {
+        uint32_t counts[2] = {(uint32_t) node.meshes.size(), (uint32_t) node.children.size()};
+        write(data, &node.transform, sizeof(glm::mat4));
+        write(data, counts, sizeof(counts));
+
+        for (auto &mesh : node.meshes)
+        {
+            writeMaterial(data, resourcePath, *mesh.material);
+            writeArray(data, mesh.vertices);
+            uint32_t shortIndices = mesh.shortIndices.empty() ? 0 : 1;
+            write(data, &shortIndices, sizeof(shortIndices));
+            if (shortIndices)
+            {
+                writeArray(data, mesh.shortIndices);
+            }
+            else
+            {
+                writeArray(data, mesh.indices);
+            }
+            writeArray(data, mesh.meshlets);
+        }
+        for (auto &child : node.children)
+        {
+            writeNode(data, resourcePath, child);
+        }
+    }
+
+    static bool readNode(Reader &reader, const std::string &resourcePath, const std::shared_ptr<MappedFile> &mapping, ModelNode &node)
+    {
+        uint32_t counts[2] = {0, 0};
+        if (!reader.read(&node.transform, sizeof(glm::mat4)) || !reader.read(counts, sizeof(counts)))
+        {
+            return false;
+        }
+
+        node.meshes.resize(counts[0]);
+        for (auto &mesh : node.meshes)
+        {
+            mesh.material = std::make_shared<Material>();
+            if (!readMaterial(reader, resourcePath, *mesh.material)
+                || !readGeometry(reader, mapping, mesh)
+                || !reader.readArray(mesh.meshlets))
+            {
+                return false;
+            }
+        }
+
+        node.children.resize(counts[1]);
+        for (auto &child : node.children)
+        {
+            if (!readNode(reader, resourcePath, mapping, child))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static bool readGeometry(Reader &reader, const std::shared_ptr<MappedFile> &mapping, ModelMesh &mesh)
+    {
+        uint32_t shortIndices = 0;
+        auto &mapped = mesh.mapped;
+        const uint16_t *indices16 = nullptr;
+        const int32_t *indices32 = nullptr;
+        if (!reader.readSection(mapped.vertices, mapped.vertexCount)
+            || !reader.read(&shortIndices, sizeof(shortIndices))
+            || !(shortIndices ? reader.readSection(indices16, mapped.indexCount) : reader.readSection(indices32, mapped.indexCount)))
+        {
+            return false;
+        }
+        mapped.file = mapping;
+        mapped.indices = shortIndices ? (const void *) indices16 : (const void *) indices32;
+        mapped.shortIndices = shortIndices != 0;
+        return true;
+    }
+
+    static void writeMaterial(std::vector<uint8_t> &data, const std::string &resourcePath, const Material &material)
+    {
+        MaterialHeader header{};
+        header.shadingModel = (uint32_t) material.shadingModel;
+        header.alphaMode = (uint32_t) material.alphaMode;
+        header.doubleSided = material.doubleSided ? 1 : 0;
+        header.textureCount = (uint32_t) material.textureData.size();
+        header.baseColor = material.baseColor;
+        write(data, &header, sizeof(MaterialHeader));
+
+        for (auto &kv : material.textureData)
+        {
+            std::string texPath = relativePath(resourcePath, kv.second.tag);
+
+            TextureHeader texHeader{};
+            texHeader.type = (uint32_t) kv.first;
+            texHeader.format = (uint32_t) kv.second.format;
+            texHeader.wrapMode[0] = (uint32_t) kv.second.wrapModeU;
+            texHeader.wrapMode[1] = (uint32_t) kv.second.wrapModeV;
+            texHeader.wrapMode[2] = (uint32_t) kv.second.wrapModeW;
+            texHeader.pathLength = (uint32_t) texPath.length();
+            write(data, &texHeader, sizeof(TextureHeader));
+            write(data, texPath.data(), texPath.length());
+        }
+    }
+
+    static bool readMaterial(Reader &reader, const std::string &resourcePath, Material &material)
+    {
+        MaterialHeader header{};
+        if (!reader.read(&header, sizeof(MaterialHeader)))
+        {
+            return false;
+        }
+        material.shadingModel = (ShadingModel) header.shadingModel;
+        material.alphaMode = (AlphaMode) header.alphaMode;
+        material.doubleSided = header.doubleSided != 0;
+        material.baseColor = header.baseColor;
+
+        for (uint32_t i = 0; i < header.textureCount; i++)
+        {
+            TextureHeader texHeader{};
+            if (!reader.read(&texHeader, sizeof(TextureHeader)))
+            {
+                return false;
+            }
+            std::string texPath(texHeader.pathLength, '\0');
+            if (texHeader.pathLength > 0 && !reader.read(&texPath[0], texHeader.pathLength))
+            {
+                return false;
+            }
+
+            auto &texData = material.textureData[(int) texHeader.type];
+            texData.tag = resolvePath(resourcePath, texPath);
+            texData.format = (TextureFormat) texHeader.format;
+            texData.wrapModeU = (WrapMode) texHeader.wrapMode[0];
+            texData.wrapModeV = (WrapMode) texHeader.wrapMode[1];
+            texData.wrapModeW = (WrapMode) texHeader.wrapMode[2];
+        }
+        return true;
+    }
+
+    // paths relative to the model so a moved asset directory still hits
+    static std::string relativePath(const std::string &resourcePath, const std::string &path)
+    {
+        std::string prefix = resourcePath + "/";
+        return path.compare(0, prefix.length(), prefix) == 0 ? path.substr(prefix.length()) : path;
+    }
+
+    static std::string resolvePath(const std::string &resourcePath, const std::string &path)
+    {
+        return path.empty() || path[0] == '/' ? path : resourcePath + "/" + path;
+    }
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _SCENE_CACHE_HPP_
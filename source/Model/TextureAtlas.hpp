@@ -0,0 +1,335 @@
+#ifndef _TEXTURE_ATLAS_HPP_
+#define _TEXTURE_ATLAS_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/Buffer.hpp"
+#include "Common/ImageUtils.hpp"
+#include "Common/Logger.hpp"
+#include "Common/RectPacker.hpp"
+#include "Model/ModelBase.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Packs small material textures into shared atlas pages at load time. A material takes
+// part if all its textures share one size no larger than maxTileSize and its meshes keep
+// their uvs in [0, 1]. Materials with the same texture types and parameters form a group,
+// each group is packed into pages with a skyline packer, the meshes' uvs are remapped and
+// the materials of a page merge into one, so those meshes bind the same textures and batch.
+// Page mip chains stop at MAX_LEVEL, below it the padding no longer separates the tiles.
+class TextureAtlas
+{
+public:
+    static constexpr size_t TILE_PADDING = 4;     // extruded edge texels, two mip levels stay clean
+    static constexpr size_t TILE_ALIGNMENT = 4;   // tiles start on bc block and mip boundaries
+    static constexpr int MAX_LEVEL = 2;           // log2(TILE_PADDING), coarser levels mix neighbouring tiles
+
+    // returns the number of pages built
+    static size_t build(const std::vector<ModelMesh *> &meshes, size_t maxTileSize, size_t pageSize)
+    {
+        // materials in first use order with their meshes
+        std::vector<Material *> materials;
+        std::unordered_map<Material *, std::vector<ModelMesh *>> users;
+        for (auto *mesh : meshes)
+        {
+            Material *material = mesh->material.get();
+            if (material == nullptr)
+            {
+                continue;
+            }
+            auto &list = users[material];
+            if (list.empty())
+            {
+                materials.push_back(material);
+            }
+            list.push_back(mesh);
+        }
+
+        std::vector<std::vector<Material *>> groups;
+        for (auto *material : materials)
+        {
+            if (!isEligible(*material, users[material], maxTileSize, pageSize))
+            {
+                continue;
+            }
+            auto it = std::find_if(groups.begin(), groups.end(), [&](const std::vector<Material *> &group)
+            {
+                return isSameGroup(*group[0], *material);
+            });
+            if (it == groups.end())
+            {
+                groups.push_back({material});
+            }
+            else
+            {
+                it->push_back(material);
+            }
+        }
+
+        size_t pageCount = 0;
+        for (auto &group : groups)
+        {
+            pageCount += buildGroup(group, users, pageSize);
+        }
+        return pageCount;
+    }
+
+private:
+    struct Tile
+    {
+        const Material *material;   // owner of the source textures
+        size_t width;
+        size_t height;
+        size_t page;
+        size_t x;                   // top left of the padded rect
+        size_t y;
+    };
+
+    static bool isAtlasTexType(int type)
+    {
+        switch ((MaterialTexType) type)
+        {
+            case MaterialTexType::ALBEDO:
+            case MaterialTexType::NORMAL:
+            case MaterialTexType::EMISSIVE:
+            case MaterialTexType::AMBIENT_OCCLUSION:
+            case MaterialTexType::METAL_ROUGHNESS:
+            case MaterialTexType::SPECULAR:
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    static size_t paddedSize(size_t size)
+    {
+        size_t padded = size + 2 * TILE_PADDING;
+        return (padded + TILE_ALIGNMENT - 1) / TILE_ALIGNMENT * TILE_ALIGNMENT;
+    }
+
+    static size_t nextPowerOfTwo(size_t value)
+    {
+        size_t ret = 1;
+        while (ret < value)
+        {
+            ret <<= 1;
+        }
+        return ret;
+    }
+
+    static bool isEligible(const Material &material, const std::vector<ModelMesh *> &meshes, size_t maxTileSize, size_t pageSize)
+    {
+        if (material.textureData.empty())
+        {
+            return false;
+        }
+
+        size_t width = material.textureData.begin()->second.width;
+        size_t height = material.textureData.begin()->second.height;
+        if (width == 0 || height == 0 || width > maxTileSize || height > maxTileSize
+            || paddedSize(width) > pageSize || paddedSize(height) > pageSize)
+        {
+            return false;
+        }
+
+        for (auto &kv : material.textureData)
+        {
+            if (!isAtlasTexType(kv.first) || kv.second.data.empty() || kv.second.compressed != nullptr
+                || kv.second.width != width || kv.second.height != height)
+            {
+                return false;
+            }
+        }
+
+        // tiling needs the texture's own wrap mode
+        const float eps = 1e-3f;
+        for (auto *mesh : meshes)
+        {
+            const Vertex *vertices = mesh->GetVertices();
+            for (size_t i = 0; i < mesh->GetVertexCount(); i++)
+            {
+                auto &uv = vertices[i].texCoords;
+                if (uv.x < -eps || uv.x > 1.0f + eps || uv.y < -eps || uv.y > 1.0f + eps)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static bool isSameGroup(const Material &a, const Material &b)
+    {
+        if (a.shadingModel != b.shadingModel || a.baseColor != b.baseColor
+            || a.alphaMode != b.alphaMode || a.doubleSided != b.doubleSided
+            || a.textureData.size() != b.textureData.size())
+        {
+            return false;
+        }
+        for (auto &kv : a.textureData)
+        {
+            auto it = b.textureData.find(kv.first);
+            if (it == b.textureData.end() || it->second.format != kv.second.format)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static size_t buildGroup(const std::vector<Material *> &group,
+                             std::unordered_map<Material *, std::vector<ModelMesh *>> &users,
+                             size_t pageSize)
+    {
+        // materials showing the same images share a tile
+        std::vector<Tile> tiles;
+        std::map<std::vector<const void *>, size_t> tileIndices;
+        std::vector<size_t> materialTiles;
+        for (auto *material : group)
+        {
+            std::vector<const void *> key;
+            for (auto &kv : material->textureData)
+            {
+                key.push_back(kv.second.data[0].get());
+            }
+            std::sort(key.begin(), key.end());
+
+            auto it = tileIndices.find(key);
+            if (it == tileIndices.end())
+            {
+                auto &texData = material->textureData.begin()->second;
+                it = tileIndices.insert({key, tiles.size()}).first;
+                tiles.push_back({material, texData.width, texData.height, 0, 0, 0});
+            }
+            materialTiles.push_back(it->second);
+        }
+
+        if (tiles.size() < 2)
+        {
+            return 0;
+        }
+
+        // tallest first packs the skyline flattest
+        std::vector<size_t> order(tiles.size());
+        for (size_t i = 0; i < order.size(); i++)
+        {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b)
+        {
+            return tiles[a].height > tiles[b].height;
+        });
+
+        std::vector<SkylinePacker> packers;
+        for (size_t idx : order)
+        {
+            auto &tile = tiles[idx];
+            size_t w = paddedSize(tile.width);
+            size_t h = paddedSize(tile.height);
+            bool placed = false;
+            for (size_t page = 0; page < packers.size() && !placed; page++)
+            {
+                if (packers[page].insert(w, h, tile.x, tile.y))
+                {
+                    tile.page = page;
+                    placed = true;
+                }
+            }
+            if (!placed)
+            {
+                packers.emplace_back(pageSize, pageSize);
+                packers.back().insert(w, h, tile.x, tile.y);
+                tile.page = packers.size() - 1;
+            }
+        }
+
+        const Material &source = *group[0];
+        std::vector<std::shared_ptr<Material>> pages(packers.size());
+        for (size_t page = 0; page < packers.size(); page++)
+        {
+            size_t pageWidth = nextPowerOfTwo(packers[page].getUsedWidth());
+            size_t pageHeight = nextPowerOfTwo(packers[page].getUsedHeight());
+
+            auto material = std::make_shared<Material>();
+            material->shadingModel = source.shadingModel;
+            material->baseColor = source.baseColor;
+            material->alphaMode = source.alphaMode;
+            material->doubleSided = source.doubleSided;
+
+            for (auto &kv : source.textureData)
+            {
+                auto buffer = Buffer<RGBA>::makeDefault(pageWidth, pageHeight);
+                memset(buffer->getRawDataPtr(), 0, pageWidth * pageHeight * sizeof(RGBA));
+                for (auto &tile : tiles)
+                {
+                    if (tile.page == page)
+                    {
+                        blitTile(*tile.material->textureData.at(kv.first).data[0], *buffer, tile.x + TILE_PADDING, tile.y + TILE_PADDING);
+                    }
+                }
+
+                auto &texData = material->textureData[kv.first];
+                texData.tag = "atlas_" + std::string(Material::materialTexTypeStr((MaterialTexType) kv.first));
+                texData.width = pageWidth;
+                texData.height = pageHeight;
+                texData.data = ImageUtils::generateMipmaps(buffer, Texture::getLinearFormat(kv.second.format) != kv.second.format);
+                texData.data.resize(std::min(texData.data.size(), (size_t) MAX_LEVEL + 1));
+                texData.maxLevel = (int) texData.data.size() - 1;
+                texData.format = kv.second.format;
+                texData.wrapModeU = WrapMode::CLAMP_TO_EDGE;
+                texData.wrapModeV = WrapMode::CLAMP_TO_EDGE;
+                texData.wrapModeW = WrapMode::CLAMP_TO_EDGE;
+            }
+
+            LOGD("texture atlas page %zu x %zu, textures: %zu", pageWidth, pageHeight, source.textureData.size());
+            pages[page] = material;
+        }
+
+        for (size_t i = 0; i < group.size(); i++)
+        {
+            auto &tile = tiles[materialTiles[i]];
+            auto &page = pages[tile.page];
+            glm::vec2 scale(tile.width / (float) page->textureData.begin()->second.width,
+                            tile.height / (float) page->textureData.begin()->second.height);
+            glm::vec2 offset((tile.x + TILE_PADDING) / (float) page->textureData.begin()->second.width,
+                             (tile.y + TILE_PADDING) / (float) page->textureData.begin()->second.height);
+            for (auto *mesh : users[group[i]])
+            {
+                // only the remapped meshes leave the scene cache mapping
+                mesh->DetachMapping();
+                for (auto &vertex : mesh->vertices)
+                {
+                    vertex.texCoords = vertex.texCoords * scale + offset;
+                }
+                mesh->material = page;
+            }
+        }
+
+        return packers.size();
+    }
+
+    // copies src with its edge texels repeated TILE_PADDING times around it
+    static void blitTile(const Buffer<RGBA> &src, Buffer<RGBA> &dst, size_t dstX, size_t dstY)
+    {
+        auto srcWidth = (int) src.getWidth();
+        auto srcHeight = (int) src.getHeight();
+        auto pad = (int) TILE_PADDING;
+        const RGBA *srcPtr = src.getRawDataPtr();
+        RGBA *dstPtr = dst.getRawDataPtr();
+        for (int y = -pad; y < srcHeight + pad; y++)
+        {
+            int sy = std::min(std::max(y, 0), srcHeight - 1);
+            RGBA *row = dstPtr + ((int) dstY + y) * dst.getWidth() + dstX;
+            for (int x = -pad; x < srcWidth + pad; x++)
+            {
+                int sx = std::min(std::max(x, 0), srcWidth - 1);
+                row[x] = srcPtr[sx + sy * srcWidth];
+            }
+        }
+    }
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _TEXTURE_ATLAS_HPP_
@@ -0,0 +1,317 @@
+#ifndef _TEXTURE_PIPELINE_HPP_
+#define _TEXTURE_PIPELINE_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/BoundedQueue.hpp"
+#include "Common/Buffer.hpp"
+#include "Common/FileUtils.hpp"
+#include "Common/HashUtils.hpp"
+#include "Common/ImageUtils.hpp"
+#include "Common/Logger.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Decoded mip chains held weakly: the materials using a chain own it, an entry is only
+// found while one of them is alive and its pixels are released with the last of them.
+template<typename Key>
+class MipChainCache
+{
+public:
+    using MipChain = std::vector<std::shared_ptr<Buffer<RGBA>>>;
+
+    bool find(const Key &key, MipChain &levels)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_chains.find(key);
+        if (it == m_chains.end())
+        {
+            return false;
+        }
+        if (!lockChain(it->second, levels))
+        {
+            m_chains.erase(it);
+            return false;
+        }
+        return true;
+    }
+
+    void insert(const Key &key, const MipChain &levels)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (auto it = m_chains.begin(); it != m_chains.end();)
+        {
+            it = it->second.empty() || it->second[0].expired() ? m_chains.erase(it) : std::next(it);
+        }
+        m_chains[key] = WeakChain(levels.begin(), levels.end());
+    }
+
+private:
+    using WeakChain = std::vector<std::weak_ptr<Buffer<RGBA>>>;
+
+    static bool lockChain(const WeakChain &chain, MipChain &levels)
+    {
+        levels.clear();
+        for (auto &level : chain)
+        {
+            auto buffer = level.lock();
+            if (nullptr == buffer)
+            {
+                levels.clear();
+                return false;
+            }
+            levels.push_back(std::move(buffer));
+        }
+        return !levels.empty();
+    }
+
+private:
+    std::map<Key, WeakChain> m_chains;
+    std::mutex m_mutex;
+};
+
+// Chains addressed by the hash of the file bytes, so one image shipped under several names
+// or directories is decoded once while any model of the loader still uses it.
+class TextureContentCache : public MipChainCache<uint64_t>
+{
+public:
+    // srgb chains are filtered differently and stored apart
+    static uint64_t makeKey(const std::vector<uint8_t> &bytes, bool srgb)
+    {
+        return HashUtils::hashContent(bytes.data(), bytes.size(), srgb ? 1 : 0);
+    }
+};
+
+// Texture files staged through bounded queues while the loader converts meshes: one thread
+// reads the files, workers decode them and build the mip chains. The reader holds a file
+// back until its encoded bytes and mip chain fit in maxBytesInFlight next to the files in
+// the pipeline and the chains the loader has not taken yet, so a model with many large
+// images does not decode them all at once.
+// Files whose bytes are already in the content cache or on their way through the pipeline
+// are not decoded again.
+class TexturePipeline
+{
+public:
+    using MipChain = std::vector<std::shared_ptr<Buffer<RGBA>>>;
+
+    TexturePipeline(size_t decodeThreads, size_t maxBytesInFlight, TextureContentCache &contentCache)
+        : m_contentCache(contentCache), m_maxBytesInFlight(maxBytesInFlight), m_encoded(std::max(decodeThreads, (size_t) 1))
+    {
+        m_reader = std::thread(&TexturePipeline::readWorker, this);
+        for (size_t i = 0; i < std::max(decodeThreads, (size_t) 1); i++)
+        {
+            m_decoders.emplace_back(&TexturePipeline::decodeWorker, this);
+        }
+    }
+
+    ~TexturePipeline()
+    {
+        m_requests.close();
+        m_reader.join();
+        m_encoded.close();
+        for (auto &decoder : m_decoders)
+        {
+            decoder.join();
+        }
+    }
+
+    // a path already requested with the same srgb flag is not read again
+    void request(const std::string &path, bool srgb)
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_resultMutex);
+            if (!m_results.insert({{path, srgb}, Result()}).second)
+            {
+                return;
+            }
+        }
+        m_requests.push({path, srgb, {}, 0, 0});
+    }
+
+    // blocks until the file left the pipeline, false if it was never requested. The chain
+    // stays charged to the in flight budget until it is handed over here
+    bool wait(const std::string &path, bool srgb, MipChain &levels)
+    {
+        std::unique_lock<std::mutex> lock(m_resultMutex);
+        auto it = m_results.find({path, srgb});
+        if (it == m_results.end())
+        {
+            return false;
+        }
+        if (!it->second.done)
+        {
+            // chains waiting for the caller fill the budget, the reader has to get to this file anyway
+            bool starving = !it->second.started;
+            if (starving)
+            {
+                setStarving(1);
+            }
+            m_resultReady.wait(lock, [&]() { return it->second.done; });
+            if (starving)
+            {
+                setStarving(-1);
+            }
+        }
+        levels = it->second.levels;
+        size_t budget = it->second.budget;
+        it->second.budget = 0;
+        lock.unlock();
+
+        releaseBytes(budget);
+        return true;
+    }
+
+private:
+    struct Job
+    {
+        std::string path;
+        bool srgb;
+        std::vector<uint8_t> bytes;
+        uint64_t contentKey;
+        size_t chainBytes;
+    };
+
+    struct Result
+    {
+        bool done = false;
+        bool started = false; // the reader got past the file, no more budget is needed for it
+        size_t budget = 0;    // chain bytes released by wait
+        MipChain levels;
+    };
+
+    void readWorker()
+    {
+        Job job;
+        while (m_requests.pop(job))
+        {
+            job.bytes = FileUtils::readBytes(job.path);
+            int width = 0;
+            int height = 0;
+            if (job.bytes.empty() || !ImageUtils::readImageInfo(job.bytes.data(), job.bytes.size(), width, height))
+            {
+                LOGE("TexturePipeline, failed to read texture with path: %s", job.path.c_str());
+                publish(job.path, job.srgb, {});
+                continue;
+            }
+
+            // same content as a file already decoded or queued
+            job.contentKey = TextureContentCache::makeKey(job.bytes, job.srgb);
+            MipChain levels;
+            if (m_contentCache.find(job.contentKey, levels))
+            {
+                publish(job.path, job.srgb, levels);
+                continue;
+            }
+            {
+                std::lock_guard<std::mutex> lock(m_resultMutex);
+                auto it = m_pendingContent.find(job.contentKey);
+                if (it != m_pendingContent.end())
+                {
+                    it->second.push_back(job.path);
+                    m_results[{job.path, job.srgb}].started = true;
+                    continue;
+                }
+                m_pendingContent[job.contentKey].push_back(job.path);
+            }
+
+            // the mips add a third to level 0
+            job.chainBytes = (size_t) width * height * sizeof(RGBA) * 4 / 3;
+            acquireBytes(job.bytes.size() + job.chainBytes);
+            {
+                std::lock_guard<std::mutex> lock(m_resultMutex);
+                m_results[{job.path, job.srgb}].started = true;
+            }
+            m_encoded.push(std::move(job));
+        }
+    }
+
+    void decodeWorker()
+    {
+        Job job;
+        while (m_encoded.pop(job))
+        {
+            auto buffer = ImageUtils::readImageRGBA(job.bytes.data(), job.bytes.size(), job.path);
+            size_t encodedBytes = job.bytes.size();
+            job.bytes = std::vector<uint8_t>();
+
+            MipChain levels;
+            if (buffer != nullptr)
+            {
+                levels = ImageUtils::generateMipmaps(buffer, job.srgb);
+            }
+            // the chain is charged once, to the path that was decoded
+            releaseBytes(levels.empty() ? encodedBytes + job.chainBytes : encodedBytes);
+            if (!levels.empty())
+            {
+                m_contentCache.insert(job.contentKey, levels);
+            }
+
+            std::vector<std::string> paths;
+            {
+                std::lock_guard<std::mutex> lock(m_resultMutex);
+                paths = std::move(m_pendingContent[job.contentKey]);
+                m_pendingContent.erase(job.contentKey);
+            }
+            for (size_t i = 0; i < paths.size(); i++)
+            {
+                publish(paths[i], job.srgb, levels, 0 == i && !levels.empty() ? job.chainBytes : 0);
+            }
+        }
+    }
+
+    // a single file larger than the limit still goes through on its own, as does any file while
+    // the caller waits for one the reader has not reached
+    void acquireBytes(size_t bytes)
+    {
+        std::unique_lock<std::mutex> lock(m_budgetMutex);
+        m_budgetAvailable.wait(lock, [&]() { return m_bytesInFlight == 0 || m_bytesInFlight + bytes <= m_maxBytesInFlight || m_starving > 0; });
+        m_bytesInFlight += bytes;
+    }
+
+    void releaseBytes(size_t bytes)
+    {
+        std::lock_guard<std::mutex> lock(m_budgetMutex);
+        m_bytesInFlight -= bytes;
+        m_budgetAvailable.notify_all();
+    }
+
+    void setStarving(int delta)
+    {
+        std::lock_guard<std::mutex> lock(m_budgetMutex);
+        m_starving += delta;
+        m_budgetAvailable.notify_all();
+    }
+
+    void publish(const std::string &path, bool srgb, const MipChain &levels, size_t budget = 0)
+    {
+        std::lock_guard<std::mutex> lock(m_resultMutex);
+        auto &result = m_results[{path, srgb}];
+        result.levels = levels;
+        result.budget = budget;
+        result.started = true;
+        result.done = true;
+        m_resultReady.notify_all();
+    }
+
+private:
+    TextureContentCache &m_contentCache;
+    size_t m_maxBytesInFlight;
+    size_t m_bytesInFlight = 0;
+    int m_starving = 0; // callers blocked on a file the reader has not reached
+    std::mutex m_budgetMutex;
+    std::condition_variable m_budgetAvailable;
+
+    BoundedQueue<Job> m_requests;
+    BoundedQueue<Job> m_encoded;
+    std::thread m_reader;
+    std::vector<std::thread> m_decoders;
+
+    std::map<std::pair<std::string, bool>, Result> m_results; // path, srgb
+    std::unordered_map<uint64_t, std::vector<std::string>> m_pendingContent; // paths waiting on a decode, the decoded one first
+    std::mutex m_resultMutex;
+    std::condition_variable m_resultReady;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _TEXTURE_PIPELINE_HPP_
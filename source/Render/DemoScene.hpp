@@ -5,6 +5,7 @@
 
 #include "Model/Model.hpp"
 #include "Model/ModelBase.hpp"
+#include "Render/Light.hpp"
 
 BEGIN_NAMESPACE(GLBase)
 
@@ -14,6 +15,7 @@ struct DemoScene
     ModelMesh floor;
     ModelMesh cube;
     ModelMesh skybox;
+    std::vector<PointLight> pointLights;
 };
 
 END_NAMESPACE(GLBase)
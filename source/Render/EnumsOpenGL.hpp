@@ -7,6 +7,7 @@
 
 #include "Render/Material.hpp"
 #include "Render/Texture.hpp"
+#include "Render/Vertex.hpp"
 
 BEGIN_NAMESPACE(GLBase)
 
@@ -42,6 +43,21 @@ static inline GLint cvtFilter(FilterMode mode)
     return GL_NEAREST;
 }
 
+// magnification has no mip levels, the mipmap modes map to their base filter
+static inline GLint cvtMagFilter(FilterMode mode)
+{
+    switch (mode)
+    {
+        case FilterMode::LINEAR:
+        case FilterMode::LINEAR_MIPMAP_LINEAR:
+        case FilterMode::LINEAR_MIPMAP_NEAREST:
+            return GL_LINEAR;
+        default:
+            break;
+    }
+    return GL_NEAREST;
+}
+
 static inline glm::vec4 cvtBorderColor(BorderColor color)
 {
     switch (color)
@@ -120,6 +136,32 @@ static inline GLint cvtPolygonMode(PolygonMode mode)
     return 0;
 }
 
+static inline GLenum cvtVertexAttributeType(VertexAttributeType type)
+{
+    switch (type)
+    {
+        CASE_CVT_GL(VertexAttributeType::FLOAT32, FLOAT);
+        CASE_CVT_GL(VertexAttributeType::FLOAT16, HALF_FLOAT);
+        CASE_CVT_GL(VertexAttributeType::INT16, SHORT);
+        CASE_CVT_GL(VertexAttributeType::UINT16, UNSIGNED_SHORT);
+        default:
+            break;
+    }
+    return 0;
+}
+
+static inline GLenum cvtIndexType(IndexType type)
+{
+    switch (type)
+    {
+        CASE_CVT_GL(IndexType::UINT32, UNSIGNED_INT);
+        CASE_CVT_GL(IndexType::UINT16, UNSIGNED_SHORT);
+        default:
+            break;
+    }
+    return 0;
+}
+
 END_NAMESPACE(GLBase)
 
 #endif // _ENUMS_OPENGL_HPP_
\ No newline at end of file
@@ -72,6 +72,34 @@ public:
                                level);
     }
 
+    void setColorAttachments(const std::vector<std::shared_ptr<Texture>> &colors)
+    {
+        m_colorAttachments.resize(colors.size());
+
+        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        std::vector<GLenum> drawBuffers(colors.size());
+        for (size_t i = 0; i < colors.size(); i++)
+        {
+            m_colorAttachments[i].tex = colors[i];
+            m_colorAttachments[i].layer = 0;
+            m_colorAttachments[i].level = 0;
+
+            drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+            glFramebufferTexture2D(GL_FRAMEBUFFER,
+                                   drawBuffers[i],
+                                   colors[i]->multiSample ? GL_TEXTURE_2D_MULTISAMPLE : GL_TEXTURE_2D,
+                                   colors[i]->getId(),
+                                   0);
+        }
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+
+        if (!colors.empty())
+        {
+            m_colorAttachment = m_colorAttachments[0];
+            m_colorReady = true;
+        }
+    }
+
     void setDepthAttachment(std::shared_ptr<Texture> &depth)
     {
         if (depth == m_depthAttachment.tex)
@@ -100,6 +128,11 @@ public:
         return m_colorAttachment;
     }
 
+    const std::vector<FramebufferAttachment> &getColorAttachments() const
+    {
+        return m_colorAttachments;
+    }
+
     const FramebufferAttachment &getDepthAttachment() const
     {
         return m_depthAttachment;
@@ -130,6 +163,7 @@ private:
     bool m_colorReady = false;
     bool m_depthReady = false;
     FramebufferAttachment m_colorAttachment{};
+    std::vector<FramebufferAttachment> m_colorAttachments;
     FramebufferAttachment m_depthAttachment{};
 
     GLuint m_fbo = 0;
@@ -0,0 +1,265 @@
+#ifndef _GLSL_PREPROCESSOR_HPP_
+#define _GLSL_PREPROCESSOR_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+
+#include "Common/FileUtils.hpp"
+#include "Common/HashUtils.hpp"
+#include "Common/Logger.hpp"
+#include "Common/OpenGLExtensions.hpp"
+#include "Config/Config.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Single pass over the source: expands #include "file" (relative to SHADER_GLSL_DIR,
+// each file once per shader) and rewrites layout qualifiers for the GL 3.3 style
+// interface. Results are cached by stage and source, defines are prepended afterwards
+// so every variant of a file shares one preprocessed body.
+class GLSLPreprocessor
+{
+public:
+    static const std::string &preprocess(const std::string &source, GLenum type)
+    {
+        uint64_t key = HashUtils::hashBytes(&type, sizeof(type));
+        key = HashUtils::hashString(source, key);
+
+        auto it = s_processedCache.find(key);
+        if (it != s_processedCache.end())
+        {
+            return it->second;
+        }
+
+        std::string result;
+        result.reserve(source.length());
+        std::set<std::string> included;
+        process(source, type, included, result);
+
+        return s_processedCache.insert({key, std::move(result)}).first->second;
+    }
+
+    // file contents are read from disk once
+    static const std::string &readFile(const std::string &path)
+    {
+        auto it = s_fileCache.find(path);
+        if (it != s_fileCache.end())
+        {
+            return it->second;
+        }
+
+        return s_fileCache.insert({path, FileUtils::readText(path)}).first->second;
+    }
+
+    static void clearCache()
+    {
+        s_fileCache.clear();
+        s_processedCache.clear();
+    }
+
+private:
+    static void process(const std::string &source, GLenum type, std::set<std::string> &included, std::string &out)
+    {
+        const size_t len = source.length();
+        bool lineStart = true;
+        size_t i = 0;
+        while (i < len)
+        {
+            char c = source[i];
+
+            // comments are copied as is
+            if (c == '/' && i + 1 < len && source[i + 1] == '/')
+            {
+                size_t end = source.find('\n', i);
+                end = (end == std::string::npos) ? len : end;
+                out.append(source, i, end - i);
+                i = end;
+                continue;
+            }
+            if (c == '/' && i + 1 < len && source[i + 1] == '*')
+            {
+                size_t end = source.find("*/", i + 2);
+                end = (end == std::string::npos) ? len : end + 2;
+                out.append(source, i, end - i);
+                i = end;
+                continue;
+            }
+
+            if (c == '#' && lineStart)
+            {
+                size_t end = source.find('\n', i);
+                end = (end == std::string::npos) ? len : end;
+                if (!processInclude(source.substr(i, end - i), type, included, out))
+                {
+                    out.append(source, i, end - i);
+                }
+                i = end;
+                continue;
+            }
+
+            if (isIdentStart(c))
+            {
+                size_t end = i + 1;
+                while (end < len && isIdentChar(source[end]))
+                {
+                    end++;
+                }
+
+                if (GL_COMPUTE_SHADER != type && 0 == source.compare(i, end - i, "layout"))
+                {
+                    i = processLayout(source, end, type, out);
+                }
+                else
+                {
+                    out.append(source, i, end - i);
+                    i = end;
+                }
+                lineStart = false;
+                continue;
+            }
+
+            if (c == '\n')
+            {
+                lineStart = true;
+            }
+            else if (c != ' ' && c != '\t' && c != '\r')
+            {
+                lineStart = false;
+            }
+            out.push_back(c);
+            i++;
+        }
+    }
+
+    static bool processInclude(const std::string &line, GLenum type, std::set<std::string> &included, std::string &out)
+    {
+        size_t pos = line.find_first_not_of(" \t", 1);
+        if (pos == std::string::npos || 0 != line.compare(pos, 7, "include"))
+        {
+            return false;
+        }
+
+        size_t begin = line.find_first_of("\"<", pos + 7);
+        size_t end = (begin == std::string::npos) ? begin : line.find_first_of("\">", begin + 1);
+        if (end == std::string::npos)
+        {
+            LOGE("GLSLPreprocessor: invalid include: %s", line.c_str());
+            return true;
+        }
+
+        std::string name = line.substr(begin + 1, end - begin - 1);
+        if (included.count(name) > 0)
+        {
+            return true;
+        }
+        included.insert(name);
+
+        const std::string &chunk = readFile(SHADER_GLSL_DIR + name);
+        if (chunk.empty())
+        {
+            LOGE("GLSLPreprocessor: include file not found: %s", name.c_str());
+            return true;
+        }
+
+        process(chunk, type, included, out);
+        if (out.empty() || out.back() != '\n')
+        {
+            out.push_back('\n');
+        }
+        return true;
+    }
+
+    // pos is just past the layout keyword, returns where copying continues
+    static size_t processLayout(const std::string &source, size_t pos, GLenum type, std::string &out)
+    {
+        size_t open = source.find_first_not_of(" \t\r\n", pos);
+        size_t close = (open != std::string::npos && source[open] == '(') ? source.find(')', open) : std::string::npos;
+        if (close == std::string::npos)
+        {
+            out.append("layout");
+            return pos;
+        }
+
+        size_t storageBegin = source.find_first_not_of(" \t\r\n", close + 1);
+        size_t storageEnd = storageBegin;
+        while (storageEnd < source.length() && isIdentChar(source[storageEnd]))
+        {
+            storageEnd++;
+        }
+
+        std::string qualifiers = source.substr(open + 1, close - open - 1);
+        std::string storage = (storageBegin == std::string::npos) ? "" : source.substr(storageBegin, storageEnd - storageBegin);
+
+        // vertex outputs and fragment inputs are matched by name
+        bool varying = (GL_VERTEX_SHADER == type && storage == "out") || (GL_FRAGMENT_SHADER == type && storage == "in");
+        if (varying && hasQualifier(qualifiers, "location"))
+        {
+            out.append(storage);
+            return storageEnd;
+        }
+
+        // bindings are assigned at runtime by ShaderProgram::bindResources
+        if (storage == "uniform")
+        {
+            if (hasQualifier(qualifiers, "std140"))
+            {
+                out.append("layout(std140) uniform");
+                return storageEnd;
+            }
+            if (hasQualifier(qualifiers, "binding"))
+            {
+                out.append(storage);
+                return storageEnd;
+            }
+        }
+
+        out.append("layout");
+        return pos;
+    }
+
+    static bool hasQualifier(const std::string &qualifiers, const char *name)
+    {
+        size_t i = 0;
+        while (i < qualifiers.length())
+        {
+            if (!isIdentStart(qualifiers[i]))
+            {
+                i++;
+                continue;
+            }
+
+            size_t end = i + 1;
+            while (end < qualifiers.length() && isIdentChar(qualifiers[end]))
+            {
+                end++;
+            }
+            if (0 == qualifiers.compare(i, end - i, name))
+            {
+                return true;
+            }
+            i = end;
+        }
+        return false;
+    }
+
+    static inline bool isIdentStart(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    static inline bool isIdentChar(char c)
+    {
+        return isIdentStart(c) || (c >= '0' && c <= '9');
+    }
+
+private:
+    static std::unordered_map<std::string, std::string> s_fileCache;
+    static std::unordered_map<uint64_t, std::string> s_processedCache;
+};
+
+std::unordered_map<std::string, std::string> GLSLPreprocessor::s_fileCache;
+std::unordered_map<uint64_t, std::string> GLSLPreprocessor::s_processedCache;
+
+END_NAMESPACE(GLBase)
+
+#endif // _GLSL_PREPROCESSOR_HPP_
@@ -7,7 +7,9 @@
 
 #include "Common/FileUtils.hpp"
 #include "Common/Logger.hpp"
+#include "Common/OpenGLExtensions.hpp"
 #include "Common/OpenGLUtils.hpp"
+#include "Render/GLSLPreprocessor.hpp"
 
 BEGIN_NAMESPACE(GLBase)
 
@@ -33,17 +35,15 @@ public:
     }
 
     bool loadSource(const std::string &source)
+    {
+        return compile(source) && checkCompileStatus();
+    }
+
+    // submit only, the status is queried later so the driver may compile in the background
+    bool compile(const std::string &source)
     {
         m_id = glCreateShader(m_type);
-        std::string shaderStr;
-        if (GL_VERTEX_SHADER == m_type)
-        {
-            shaderStr = compatibleVertexPreprocess(m_header + m_defines + source);
-        }
-        else if (GL_FRAGMENT_SHADER == m_type)
-        {
-            shaderStr = compatibleFragmentPreprocess(m_header + m_defines + source);
-        }
+        std::string shaderStr = m_header + m_defines + GLSLPreprocessor::preprocess(source, m_type);
         if (shaderStr.empty())
         {
             LOGE("GLSLUtils::loadSource failed: empty source");
@@ -54,7 +54,11 @@ public:
         auto length = (GLint)shaderStr.length();
         GL_CHECK(glShaderSource(m_id, 1, &shaderStrPtr, &length));
         GL_CHECK(glCompileShader(m_id));
+        return true;
+    }
 
+    bool checkCompileStatus()
+    {
         GLint isCompiled = 0;
         GL_CHECK(glGetShaderiv(m_id, GL_COMPILE_STATUS, &isCompiled));
         if (GL_FALSE == isCompiled)
@@ -74,7 +78,7 @@ public:
 
     bool loadFile(const std::string &path)
     {
-        std::string source = FileUtils::readText(path);
+        const std::string &source = GLSLPreprocessor::readFile(path);
         if (source.length() <= 0 )
         {
             LOGE("read shader source failed");
@@ -103,38 +107,9 @@ public:
         return m_id;
     }
 
-private:
-    std::string compatibleVertexPreprocess(const std::string &source)
-    {
-        std::regex outLocationRegex(R"(layout\s*\(\s*location\s*=\s*\d+\s*\)\s*out\s*)");
-        std::regex std140Regex(R"(layout\s*\(.*std140.*\)\s*uniform\s*)");
-        std::regex uniformBindingRegex(R"(layout\s*\(.*binding\s*=.*\)\s*uniform\s*)");
-
-        std::string result = std::regex_replace(source, outLocationRegex, "out ");
-        result = std::regex_replace(result, std140Regex, "layout (std140) uniform ");
-        result = std::regex_replace(result, uniformBindingRegex, "uniform ");
-
-        return result;
-    }
-
-    std::string compatibleFragmentPreprocess(const std::string &source)
-    {
-        std::regex inLocationRegex(R"(layout\s*\(\s*location\s*=\s*\d+\s*\)\s*in\s*)");
-        std::regex outLocationRegex(R"(layout\s*\(\s*location\s*=\s*\d+\s*\)\s*out\s*)");
-        std::regex std140Regex(R"(layout\s*\(.*std140.*\)\s*uniform\s*)");
-        std::regex uniformBindingRegex(R"(layout\s*\(.*binding\s*=.*\)\s*uniform\s*)");
-
-        std::string result = std::regex_replace(source, inLocationRegex, "in ");
-        result = std::regex_replace(result, outLocationRegex, "out ");
-        result = std::regex_replace(result, std140Regex, "layout (std140) uniform ");
-        result = std::regex_replace(result, uniformBindingRegex, "uniform ");
-
-        return result;
-    }
-
 private:
     GLenum m_type;
-    GLuint m_id;
+    GLuint m_id = 0;
     std::string m_header;
     std::string m_defines;
 };
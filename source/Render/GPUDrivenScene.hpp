@@ -0,0 +1,268 @@
+#ifndef _GPU_DRIVEN_SCENE_HPP_
+#define _GPU_DRIVEN_SCENE_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+#include "Common/GLMInc.hpp"
+
+#include "Common/OpenGLExtensions.hpp"
+#include "Model/ModelBase.hpp"
+#include "Render/ShaderStorageBlock.hpp"
+#include "Render/VertexArrayObject.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+const int DRAW_ID_ATTRIBUTE_LOCATION = 4;
+
+// std430 layout, matches struct DrawInstance in shaders
+struct DrawInstance
+{
+    alignas(16) glm::mat4 modelMatrix;
+    alignas(16) glm::mat4 normalMatrix;
+    alignas(16) glm::vec4 boundsMin;
+    alignas(16) glm::vec4 boundsMax;
+    alignas(16) glm::uvec4 drawParams; // index count, first index, base vertex, batch index
+    alignas(16) glm::uvec4 drawFlags;  // cast shadow
+    alignas(16) glm::vec4 cone;        // normal cone axis in mesh space, cutoff, 1 disables the test
+};
+
+// std430 layout, drawCount is the atomic append counter of the culling pass
+struct DrawBatch
+{
+    uint32_t commandOffset = 0;
+    uint32_t drawCount = 0;
+};
+
+struct DrawElementsIndirectCommand
+{
+    uint32_t count;
+    uint32_t instanceCount;
+    uint32_t firstIndex;
+    int32_t baseVertex;
+    uint32_t baseInstance;
+};
+
+struct IndirectBatch
+{
+    std::shared_ptr<Material> material;
+    uint32_t commandOffset = 0;
+    uint32_t commandCount = 0;
+};
+
+// Opaque meshes merged into one vertex/index buffer, drawn by material batches with
+// glMultiDrawElementsIndirect. Commands are written by the culling compute pass, meshes
+// split into meshlets are culled and drawn per meshlet.
+class GPUDrivenScene
+{
+public:
+    void addMesh(ModelMesh &mesh, const glm::mat4 &transform, bool castShadow)
+    {
+        m_entries.push_back({&mesh, transform, castShadow});
+    }
+
+    // packed formats merge each mesh's own packed vertices, quantized ones keep their
+    // per mesh decode in the instance model matrix
+    bool build(VertexFormat format = VertexFormat::Float32)
+    {
+        if (m_entries.empty())
+        {
+            return false;
+        }
+
+        // group instances by material, one batch per material
+        std::unordered_map<Material *, size_t> batchIndices;
+        std::vector<std::vector<size_t>> batchEntries;
+        for (size_t i = 0; i < m_entries.size(); i++)
+        {
+            Material *material = m_entries[i].mesh->material.get();
+            auto it = batchIndices.find(material);
+            if (it == batchIndices.end())
+            {
+                it = batchIndices.insert({material, batchEntries.size()}).first;
+                batchEntries.emplace_back();
+
+                IndirectBatch batch;
+                batch.material = m_entries[i].mesh->material;
+                m_batches.push_back(batch);
+            }
+            batchEntries[it->second].push_back(i);
+        }
+
+        // merge geometry, a mesh shared by several instances is stored once
+        std::unordered_map<ModelMesh *, glm::uvec3> meshRanges;
+        for (size_t b = 0; b < batchEntries.size(); b++)
+        {
+            auto &batch = m_batches[b];
+            batch.commandOffset = (uint32_t) m_instances.size();
+
+            for (auto entryIdx : batchEntries[b])
+            {
+                auto &entry = m_entries[entryIdx];
+                auto it = meshRanges.find(entry.mesh);
+                if (it == meshRanges.end())
+                {
+                    if (0 == entry.mesh->GetVertexCount())
+                    {
+                        LOGE("GPUDrivenScene::build, mesh without cpu vertices, mapped meshes are released after their upload");
+                        return false;
+                    }
+                    glm::uvec3 range((uint32_t) entry.mesh->GetIndexCount(), (uint32_t) m_geometry.indices.size(), (uint32_t) m_geometry.vertices.size());
+                    m_geometry.vertices.insert(m_geometry.vertices.end(), entry.mesh->GetVertices(), entry.mesh->GetVertices() + entry.mesh->GetVertexCount());
+                    if (VertexFormat::Float32 != format)
+                    {
+                        if (entry.mesh->vertexFormat != format)
+                        {
+                            entry.mesh->InitVertexArray(format);
+                        }
+                        m_geometry.packedVertices.insert(m_geometry.packedVertices.end(), entry.mesh->packedVertices.begin(), entry.mesh->packedVertices.end());
+                    }
+                    for (size_t i = 0; i < entry.mesh->GetIndexCount(); i++)
+                    {
+                        m_geometry.indices.push_back((int32_t) entry.mesh->GetIndex(i));
+                    }
+                    it = meshRanges.insert({entry.mesh, range}).first;
+                }
+
+                // one instance per meshlet, the cone test is only valid for single sided faces
+                auto &meshlets = entry.mesh->meshlets;
+                bool coneCulling = !entry.mesh->material->doubleSided;
+                if (meshlets.empty())
+                {
+                    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+                    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+                    const Vertex *vertices = entry.mesh->GetVertices();
+                    for (size_t i = 0; i < entry.mesh->GetVertexCount(); i++)
+                    {
+                        boundsMin = glm::min(boundsMin, vertices[i].position);
+                        boundsMax = glm::max(boundsMax, vertices[i].position);
+                    }
+                    addInstance(entry, it->second, boundsMin, boundsMax, glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), (uint32_t) b);
+                }
+                for (auto &meshlet : meshlets)
+                {
+                    glm::uvec3 range(meshlet.indexCount, it->second.y + meshlet.firstIndex, it->second.z);
+                    glm::vec4 cone(meshlet.coneAxis, coneCulling ? meshlet.coneCutoff : 1.0f);
+                    addInstance(entry, range, meshlet.boundsMin, meshlet.boundsMax, cone, (uint32_t) b);
+                }
+            }
+
+            batch.commandCount = (uint32_t) m_instances.size() - batch.commandOffset;
+        }
+        m_commandCount = (uint32_t) m_instances.size();
+
+        m_geometry.primitiveType = PrimitiveType::TRIANGLE;
+        m_geometry.vertexFormat = format;
+        m_geometry.InitVertexLayout();
+        m_vao = std::make_shared<VertexArrayObject>(m_geometry);
+        m_vao->setDrawIdAttribute(DRAW_ID_ATTRIBUTE_LOCATION, m_instances.size());
+        size_t vertexCount = m_geometry.vertices.size();
+        m_geometry = ModelBase(); // the merged arrays only live for the upload
+
+        m_storageInstances = std::make_shared<ShaderStorageBlock>("DrawInstances", (int) (m_instances.size() * sizeof(DrawInstance)));
+        m_storageInstances->setData(m_instances.data(), (int) (m_instances.size() * sizeof(DrawInstance)));
+        m_storageBatches = std::make_shared<ShaderStorageBlock>("DrawBatches", (int) (m_batches.size() * sizeof(DrawBatch)));
+        m_storageCommands = std::make_shared<ShaderStorageBlock>("DrawCommands", (int) (m_commandCount * sizeof(DrawElementsIndirectCommand)));
+
+        LOGI("GPU driven scene: meshes %d, instances %d, batches %d, vertices %d", m_entries.size(), m_instances.size(), m_batches.size(), vertexCount);
+        return true;
+    }
+
+    // zero the command buffer so slots past the culled count are empty draws
+    void resetCommands()
+    {
+        std::vector<DrawBatch> batches(m_batches.size());
+        for (size_t i = 0; i < m_batches.size(); i++)
+        {
+            batches[i].commandOffset = m_batches[i].commandOffset;
+        }
+        m_storageBatches->setData(batches.data(), (int) (batches.size() * sizeof(DrawBatch)));
+
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_storageCommands->getId());
+        glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    }
+
+    void drawBatch(const IndirectBatch &batch)
+    {
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_storageCommands->getId());
+        glMultiDrawElementsIndirect(GL_TRIANGLES, m_vao->getIndexType(),
+                                    (void *) (batch.commandOffset * sizeof(DrawElementsIndirectCommand)),
+                                    (GLsizei) batch.commandCount, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    inline std::shared_ptr<VertexArrayObject> &getVertexArrayObject()
+    {
+        return m_vao;
+    }
+
+    inline const std::vector<IndirectBatch> &getBatches() const
+    {
+        return m_batches;
+    }
+
+    inline size_t getInstanceCount() const
+    {
+        return m_instances.size();
+    }
+
+    inline std::shared_ptr<ShaderStorageBlock> &getInstancesBlock()
+    {
+        return m_storageInstances;
+    }
+
+    inline std::shared_ptr<ShaderStorageBlock> &getBatchesBlock()
+    {
+        return m_storageBatches;
+    }
+
+    inline std::shared_ptr<ShaderStorageBlock> &getCommandsBlock()
+    {
+        return m_storageCommands;
+    }
+
+private:
+    struct MeshEntry
+    {
+        ModelMesh *mesh;
+        glm::mat4 transform;
+        bool castShadow;
+    };
+
+    // range is index count, first index, base vertex in the merged buffers, bounds in mesh space
+    void addInstance(const MeshEntry &entry, const glm::uvec3 &range, glm::vec3 boundsMin, glm::vec3 boundsMax,
+                     const glm::vec4 &cone, uint32_t batchIndex)
+    {
+        // bounds in the space of the stored positions
+        glm::mat4 encode = glm::inverse(entry.mesh->positionDecode);
+        boundsMin = glm::vec3(encode * glm::vec4(boundsMin, 1.0f));
+        boundsMax = glm::vec3(encode * glm::vec4(boundsMax, 1.0f));
+
+        DrawInstance instance{};
+        instance.modelMatrix = entry.transform * entry.mesh->positionDecode;
+        instance.normalMatrix = glm::transpose(glm::inverse(entry.transform));
+        instance.boundsMin = glm::vec4(boundsMin, 1.0f);
+        instance.boundsMax = glm::vec4(boundsMax, 1.0f);
+        instance.drawParams = glm::uvec4(range, batchIndex);
+        instance.drawFlags = glm::uvec4(entry.castShadow ? 1 : 0, 0, 0, 0);
+        instance.cone = cone;
+        m_instances.push_back(instance);
+    }
+
+private:
+    std::vector<MeshEntry> m_entries;
+    std::vector<IndirectBatch> m_batches;
+    std::vector<DrawInstance> m_instances;
+    uint32_t m_commandCount = 0;
+
+    ModelBase m_geometry;
+    std::shared_ptr<VertexArrayObject> m_vao = nullptr;
+
+    std::shared_ptr<ShaderStorageBlock> m_storageInstances = nullptr;
+    std::shared_ptr<ShaderStorageBlock> m_storageBatches = nullptr;
+    std::shared_ptr<ShaderStorageBlock> m_storageCommands = nullptr;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _GPU_DRIVEN_SCENE_HPP_
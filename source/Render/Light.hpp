@@ -0,0 +1,21 @@
+#ifndef _LIGHT_HPP_
+#define _LIGHT_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/GLMInc.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// std430 layout, matches struct PointLight in shaders
+struct PointLight
+{
+    alignas(16) glm::vec3 position;
+    float radius = 1.0f;
+    alignas(16) glm::vec3 color;
+    float intensity = 1.0f;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _LIGHT_HPP_
@@ -0,0 +1,299 @@
+#ifndef _LIGHT_CLUSTERING_HPP_
+#define _LIGHT_CLUSTERING_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/GLMInc.hpp"
+#include "Common/SIMD.hpp"
+#include "Common/ThreadPool.hpp"
+#include "Render/Light.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+const int CLUSTER_GRID_X = 16;
+const int CLUSTER_GRID_Y = 16;
+const int CLUSTER_GRID_Z = 24;
+const int MAX_LIGHTS_PER_CLUSTER = 128;
+
+// Clustered light assignment, the view frustum is split into a screen space grid with
+// exponential depth slices. Each depth slice is culled by a ThreadPool worker.
+class LightClustering
+{
+public:
+    LightClustering()
+    {
+        size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+        m_threadPool = std::make_shared<ThreadPool>(threadCount);
+
+        m_clusterCount = CLUSTER_GRID_X * CLUSTER_GRID_Y * CLUSTER_GRID_Z;
+        m_clusterBounds.resize(m_clusterCount);
+        m_clusterCounts.resize(m_clusterCount);
+        m_clusterSlots.resize(m_clusterCount * MAX_LIGHTS_PER_CLUSTER);
+        m_sliceLights.resize(CLUSTER_GRID_Z);
+        m_grid.resize(m_clusterCount);
+    }
+
+    void setProjection(const glm::mat4 &projection, float near, float far)
+    {
+        if (projection == m_projection && near == m_near && far == m_far)
+            return;
+
+        m_projection = projection;
+        m_near = near;
+        m_far = far;
+
+        // slice = log(depth) * scale + bias
+        float logRatio = std::log(far / near);
+        m_depthScale = (float)CLUSTER_GRID_Z / logRatio;
+        m_depthBias = -(float)CLUSTER_GRID_Z * std::log(near) / logRatio;
+
+        buildClusterBounds();
+    }
+
+    void assignLights(const std::vector<PointLight> &lights, const glm::mat4 &viewMatrix)
+    {
+        // lights to view space, binned into the depth slices they touch
+        for (auto &slice : m_sliceLights)
+        {
+            slice.clear();
+        }
+
+        for (size_t i = 0; i < lights.size(); i++)
+        {
+            glm::vec3 pos = glm::vec3(viewMatrix * glm::vec4(lights[i].position, 1.0f));
+            float radius = lights[i].radius;
+            if (-pos.z + radius < m_near || -pos.z - radius > m_far)
+                continue;
+
+            int sliceMin = getDepthSlice(-pos.z - radius);
+            int sliceMax = getDepthSlice(-pos.z + radius);
+            for (int z = sliceMin; z <= sliceMax; z++)
+            {
+                auto &slice = m_sliceLights[z];
+                slice.x.push_back(pos.x);
+                slice.y.push_back(pos.y);
+                slice.z.push_back(pos.z);
+                slice.radius.push_back(radius);
+                slice.index.push_back((uint32_t) i);
+            }
+        }
+
+        for (int z = 0; z < CLUSTER_GRID_Z; z++)
+        {
+            m_threadPool->pushTask([&, z](size_t threadId)
+            {
+                cullSlice(z);
+            });
+        }
+        m_threadPool->waitTasksFinish();
+
+        // compact the fixed size slots into (offset, count) and a flat index list
+        m_indices.clear();
+        for (int i = 0; i < m_clusterCount; i++)
+        {
+            uint32_t count = m_clusterCounts[i];
+            m_grid[i] = glm::uvec2((uint32_t) m_indices.size(), count);
+            auto *slots = &m_clusterSlots[i * MAX_LIGHTS_PER_CLUSTER];
+            m_indices.insert(m_indices.end(), slots, slots + count);
+        }
+
+        // keep the storage block non-empty
+        if (m_indices.empty())
+        {
+            m_indices.push_back(0);
+        }
+    }
+
+    inline const std::vector<glm::uvec2> &getLightGrid() const
+    {
+        return m_grid;
+    }
+
+    inline const std::vector<uint32_t> &getLightIndices() const
+    {
+        return m_indices;
+    }
+
+    inline glm::uvec4 getGridSize() const
+    {
+        return {CLUSTER_GRID_X, CLUSTER_GRID_Y, CLUSTER_GRID_Z, MAX_LIGHTS_PER_CLUSTER};
+    }
+
+    inline glm::vec4 getDepthParams() const
+    {
+        return {m_depthScale, m_depthBias, m_near, m_far};
+    }
+
+private:
+    struct ClusterBounds
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    // structure of arrays, padded to a multiple of 4 before culling
+    struct SliceLights
+    {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> radius;
+        std::vector<uint32_t> index;
+
+        void clear()
+        {
+            x.clear();
+            y.clear();
+            z.clear();
+            radius.clear();
+            index.clear();
+        }
+    };
+
+    int getDepthSlice(float depth) const
+    {
+        if (depth <= m_near)
+            return 0;
+
+        int slice = (int) std::floor(std::log(depth) * m_depthScale + m_depthBias);
+        return glm::clamp(slice, 0, CLUSTER_GRID_Z - 1);
+    }
+
+    void buildClusterBounds()
+    {
+        glm::mat4 inverseProjection = glm::inverse(m_projection);
+        auto unproject = [&](float x, float y) -> glm::vec3
+        {
+            glm::vec4 p = inverseProjection * glm::vec4(x, y, 1.0f, 1.0f);
+            return glm::vec3(p) / p.w;
+        };
+
+        for (int z = 0; z < CLUSTER_GRID_Z; z++)
+        {
+            float depthNear = m_near * std::pow(m_far / m_near, (float) z / CLUSTER_GRID_Z);
+            float depthFar = m_near * std::pow(m_far / m_near, (float) (z + 1) / CLUSTER_GRID_Z);
+
+            for (int y = 0; y < CLUSTER_GRID_Y; y++)
+            {
+                for (int x = 0; x < CLUSTER_GRID_X; x++)
+                {
+                    float x0 = (float) x / CLUSTER_GRID_X * 2.0f - 1.0f;
+                    float x1 = (float) (x + 1) / CLUSTER_GRID_X * 2.0f - 1.0f;
+                    float y0 = (float) y / CLUSTER_GRID_Y * 2.0f - 1.0f;
+                    float y1 = (float) (y + 1) / CLUSTER_GRID_Y * 2.0f - 1.0f;
+                    glm::vec3 corners[4] = {unproject(x0, y0), unproject(x1, y0), unproject(x0, y1), unproject(x1, y1)};
+
+                    ClusterBounds &bounds = m_clusterBounds[getClusterIndex(x, y, z)];
+                    bounds.min = glm::vec3(std::numeric_limits<float>::max());
+                    bounds.max = glm::vec3(-std::numeric_limits<float>::max());
+                    for (auto &corner : corners)
+                    {
+                        // points on the tile edge rays at the slice near and far depth
+                        glm::vec3 pNear = corner * (depthNear / -corner.z);
+                        glm::vec3 pFar = corner * (depthFar / -corner.z);
+                        bounds.min = glm::min(bounds.min, glm::min(pNear, pFar));
+                        bounds.max = glm::max(bounds.max, glm::max(pNear, pFar));
+                    }
+                }
+            }
+        }
+    }
+
+    void cullSlice(int z)
+    {
+        auto &lights = m_sliceLights[z];
+        size_t lightCount = lights.index.size();
+
+        // padding lights sit far behind the camera with zero radius
+        while (lights.x.size() % 4 != 0)
+        {
+            lights.x.push_back(0.0f);
+            lights.y.push_back(0.0f);
+            lights.z.push_back(1e18f);
+            lights.radius.push_back(0.0f);
+        }
+
+        for (int y = 0; y < CLUSTER_GRID_Y; y++)
+        {
+            for (int x = 0; x < CLUSTER_GRID_X; x++)
+            {
+                int clusterIdx = getClusterIndex(x, y, z);
+                ClusterBounds &bounds = m_clusterBounds[clusterIdx];
+                uint32_t *slots = &m_clusterSlots[clusterIdx * MAX_LIGHTS_PER_CLUSTER];
+                uint32_t count = 0;
+
+                for (size_t i = 0; i < lightCount && count < MAX_LIGHTS_PER_CLUSTER; i += 4)
+                {
+                    int mask = sphereIntersectAABB4(&lights.x[i], &lights.y[i], &lights.z[i], &lights.radius[i], bounds);
+                    for (size_t j = 0; j < 4 && count < MAX_LIGHTS_PER_CLUSTER; j++)
+                    {
+                        if ((mask & (1 << j)) && i + j < lightCount)
+                        {
+                            slots[count++] = lights.index[i + j];
+                        }
+                    }
+                }
+                m_clusterCounts[clusterIdx] = count;
+            }
+        }
+    }
+
+    // bit i of the result is set if sphere i touches the box
+    static int sphereIntersectAABB4(const float *x, const float *y, const float *z, const float *r, const ClusterBounds &bounds)
+    {
+#if defined(SIMD_SSE2)
+        __m128 px = _mm_loadu_ps(x);
+        __m128 py = _mm_loadu_ps(y);
+        __m128 pz = _mm_loadu_ps(z);
+        __m128 pr = _mm_loadu_ps(r);
+
+        __m128 dx = _mm_sub_ps(px, _mm_min_ps(_mm_max_ps(px, _mm_set1_ps(bounds.min.x)), _mm_set1_ps(bounds.max.x)));
+        __m128 dy = _mm_sub_ps(py, _mm_min_ps(_mm_max_ps(py, _mm_set1_ps(bounds.min.y)), _mm_set1_ps(bounds.max.y)));
+        __m128 dz = _mm_sub_ps(pz, _mm_min_ps(_mm_max_ps(pz, _mm_set1_ps(bounds.min.z)), _mm_set1_ps(bounds.max.z)));
+
+        __m128 dist2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+        return _mm_movemask_ps(_mm_cmple_ps(dist2, _mm_mul_ps(pr, pr)));
+#else
+        int mask = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            glm::vec3 p(x[i], y[i], z[i]);
+            glm::vec3 d = p - glm::clamp(p, bounds.min, bounds.max);
+            if (glm::dot(d, d) <= r[i] * r[i])
+            {
+                mask |= 1 << i;
+            }
+        }
+        return mask;
+#endif
+    }
+
+    static inline int getClusterIndex(int x, int y, int z)
+    {
+        return (z * CLUSTER_GRID_Y + y) * CLUSTER_GRID_X + x;
+    }
+
+private:
+    std::shared_ptr<ThreadPool> m_threadPool = nullptr;
+
+    glm::mat4 m_projection{0.0f};
+    float m_near = 0.0f;
+    float m_far = 0.0f;
+    float m_depthScale = 0.0f;
+    float m_depthBias = 0.0f;
+
+    int m_clusterCount = 0;
+    std::vector<ClusterBounds> m_clusterBounds;
+    std::vector<SliceLights> m_sliceLights;
+
+    // fixed capacity per cluster, so workers write without synchronization
+    std::vector<uint32_t> m_clusterCounts;
+    std::vector<uint32_t> m_clusterSlots;
+
+    std::vector<glm::uvec2> m_grid;
+    std::vector<uint32_t> m_indices;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _LIGHT_CLUSTERING_HPP_
@@ -20,7 +20,10 @@ struct TextureData
     std::string tag;
     size_t width = 0;
     size_t height = 0;
-    std::vector<std::shared_ptr<Buffer<RGBA>>> data;
+    std::vector<std::shared_ptr<Buffer<RGBA>>> data; // level 0 first, the full mip chain unless maxLevel cuts it short
+    std::shared_ptr<CompressedImage> compressed; // BCn chain, data stays as the fallback
+    int maxLevel = -1; // coarsest level the chain goes down to, -1 for the full chain
+    TextureFormat format = TextureFormat::RGBA8; // format of the uncompressed texture
     WrapMode wrapModeU = WrapMode::REPEAT;
     WrapMode wrapModeV = WrapMode::REPEAT;
     WrapMode wrapModeW = WrapMode::REPEAT;
@@ -39,6 +42,7 @@ enum class ShadingModel
     BlinnPhong,
     PBR,
     Skybox,
+    GBuffer,
 };
 
 enum class MaterialTexType
@@ -61,6 +65,14 @@ enum class MaterialTexType
   QUAD_FILTER,
 
   SHADOWMAP,
+
+  GBUFFER_ALBEDO,
+  GBUFFER_NORMAL,
+  GBUFFER_POSITION,
+  GBUFFER_EMISSIVE,
+
+  DEPTH,
+  HIZ,
 };
 
 enum class UniformBlockType
@@ -68,6 +80,18 @@ enum class UniformBlockType
     Scene,
     Model,
     Material,
+    Lights,
+    Culling,
+};
+
+enum class StorageBlockType
+{
+    PointLights,
+    ClusterLightGrid,
+    ClusterLightIndices,
+    DrawInstances,
+    DrawBatches,
+    DrawCommands,
 };
 
 struct UniformsScene
@@ -82,7 +106,7 @@ struct UniformsModel
 {
     alignas(16) glm::mat4 u_modelMatrix;
     alignas(16) glm::mat4 u_modelViewProjectionMatrix;
-    alignas(16) glm::mat3 u_inverseTransposeModelMatrix;
+    alignas(16) glm::mat3x4 u_inverseTransposeModelMatrix; // std140 mat3, columns padded to vec4
     alignas(16) glm::mat4 u_shadowMVPMatrix;
 };
 
@@ -90,15 +114,40 @@ struct UniformsMaterial
 {
     alignas(4) glm::float32_t u_kSpecular;
     alignas(16) glm::vec4 u_baseColor;
+    alignas(4) glm::uint32_t u_textureFlags;
+};
+
+struct UniformsLights
+{
+    alignas(16) glm::mat4 u_viewMatrix;
+    alignas(16) glm::mat4 u_projectionMatrix;
+    alignas(16) glm::mat4 u_inverseProjectionMatrix;
+    alignas(16) glm::mat4 u_shadowVPMatrix;
+    alignas(16) glm::ivec2 u_screenSize;
+    alignas(4) glm::int32_t u_pointLightCount;
+    alignas(16) glm::uvec4 u_clusterGridSize;
+    alignas(16) glm::vec4 u_clusterDepthParams;
+};
+
+struct UniformsCulling
+{
+    alignas(16) glm::mat4 u_cullViewProjection;
+    alignas(16) glm::mat4 u_hizViewProjection;
+    alignas(16) glm::vec4 u_frustumPlanes[6];
+    alignas(16) glm::ivec4 u_cullParams; // instance count, shadow pass, hi-z enabled, hi-z mip count
+    alignas(16) glm::vec4 u_cullCameraPos;
 };
 
 class MaterialObject
 {
 public:
     ShadingModel shadingModel = ShadingModel::Unknown;
+    std::set<std::string> shaderDefines;
     std::shared_ptr<PipelineStates> pipelineStates;
     std::shared_ptr<ShaderProgram> shaderProgram;
+    std::shared_ptr<ShaderProgram> fallbackProgram; // drawn with while shaderProgram compiles
     std::shared_ptr<ShaderResources> shaderResources;
+    size_t variantKey = 0; // specialized program key, draws are counted by the variant policy
 };
 
 class Material
@@ -112,6 +161,7 @@ public:
             CASE_ENUM_STR(ShadingModel::BaseColor);
             CASE_ENUM_STR(ShadingModel::BlinnPhong);
             CASE_ENUM_STR(ShadingModel::PBR);
+            CASE_ENUM_STR(ShadingModel::GBuffer);
             //CASE_ENUM_STR(ShadingModel::Skybox);
             //CASE_ENUM_STR(ShadingModel::IBL_Irradiance);
             //CASE_ENUM_STR(ShadingModel::IBL_Prefilter);
@@ -122,6 +172,27 @@ public:
         return "";
     }
 
+    // smallest 8 bit format holding the channels the shaders read, color maps are srgb
+    static TextureFormat textureFormat(MaterialTexType usage)
+    {
+        switch (usage)
+        {
+            case MaterialTexType::ALBEDO:
+            case MaterialTexType::EMISSIVE:
+                return TextureFormat::SRGB8_ALPHA8;
+            case MaterialTexType::NORMAL:
+                return TextureFormat::RG8;    // z is rebuilt in the shader
+            case MaterialTexType::AMBIENT_OCCLUSION:
+                return TextureFormat::R8;
+            case MaterialTexType::METAL_ROUGHNESS:
+            case MaterialTexType::SPECULAR:
+                return TextureFormat::RGB8;
+            default:
+                break;
+        }
+        return TextureFormat::RGBA8;
+    }
+
     static const char *materialTexTypeStr(MaterialTexType usage)
     {
         switch (usage)
@@ -139,6 +210,12 @@ public:
             CASE_ENUM_STR(MaterialTexType::IBL_PREFILTER);
             CASE_ENUM_STR(MaterialTexType::QUAD_FILTER);
             CASE_ENUM_STR(MaterialTexType::SHADOWMAP);
+            CASE_ENUM_STR(MaterialTexType::GBUFFER_ALBEDO);
+            CASE_ENUM_STR(MaterialTexType::GBUFFER_NORMAL);
+            CASE_ENUM_STR(MaterialTexType::GBUFFER_POSITION);
+            CASE_ENUM_STR(MaterialTexType::GBUFFER_EMISSIVE);
+            CASE_ENUM_STR(MaterialTexType::DEPTH);
+            CASE_ENUM_STR(MaterialTexType::HIZ);
             default:
                 break;
         }
@@ -182,6 +259,12 @@ public:
             case MaterialTexType::IBL_PREFILTER:      return "u_prefilterMap";
             case MaterialTexType::QUAD_FILTER:        return "u_screenTexture";
             case MaterialTexType::SHADOWMAP:          return "u_shadowMap";
+            case MaterialTexType::GBUFFER_ALBEDO:     return "u_gBufferAlbedo";
+            case MaterialTexType::GBUFFER_NORMAL:     return "u_gBufferNormal";
+            case MaterialTexType::GBUFFER_POSITION:   return "u_gBufferPosition";
+            case MaterialTexType::GBUFFER_EMISSIVE:   return "u_gBufferEmissive";
+            case MaterialTexType::DEPTH:              return "u_depthMap";
+            case MaterialTexType::HIZ:                return "u_hizMap";
             default:
                 break;
         }
@@ -199,6 +282,8 @@ public:
     std::unordered_map<int, std::shared_ptr<Texture>> textures;
     std::shared_ptr<MaterialObject> materialObj = nullptr;
     std::set<std::string> shaderDefines;
+    uint32_t textureFlags = 0; // bit (1 << MaterialTexType) per resident texture, read by the uber shader
+    bool texturesResident = false;
 };
 
 END_NAMESPACE(GLBase)
@@ -0,0 +1,171 @@
+#ifndef _PROGRAM_BINARY_CACHE_HPP_
+#define _PROGRAM_BINARY_CACHE_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+
+#include "Common/DiskCache.hpp"
+#include "Common/FileUtils.hpp"
+#include "Common/HashUtils.hpp"
+#include "Common/Logger.hpp"
+#include "Common/OpenGLExtensions.hpp"
+#include "Common/OpenGLUtils.hpp"
+#include "Config/Config.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// bump when the cache file layout or the key composition changes
+const uint32_t PROGRAM_BINARY_CACHE_VERSION = 2;
+
+// Linked program blobs stored on disk, one file per variant. The key covers the
+// shader sources, the define set and the driver identity, a driver update or a
+// format the driver no longer accepts falls back to compiling from source.
+class ProgramBinaryCache
+{
+public:
+    static bool enabled()
+    {
+        return s_enabled && OpenGLExtensions::hasProgramBinary();
+    }
+
+    static void setEnabled(bool enabled)
+    {
+        s_enabled = enabled;
+    }
+
+    static uint64_t makeKey(const std::vector<std::string> &sources, const std::string &defines)
+    {
+        uint64_t key = HashUtils::hashBytes(&PROGRAM_BINARY_CACHE_VERSION, sizeof(PROGRAM_BINARY_CACHE_VERSION));
+        key = HashUtils::hashString(getDriverString(), key);
+        key = HashUtils::hashString(defines, key);
+        for (auto &source : sources)
+        {
+            // length first so that moving text between stages changes the key
+            uint64_t length = source.length();
+            key = HashUtils::hashBytes(&length, sizeof(length), key);
+            key = HashUtils::hashString(source, key);
+        }
+        return key;
+    }
+
+    // the program is relinked from the blob, returns false if missing or rejected by the driver
+    static bool load(uint64_t key, GLuint programId)
+    {
+        if (!enabled())
+        {
+            return false;
+        }
+
+        auto &cache = diskCache();
+        std::string path = cache.getPath(key);
+        if (!FileUtils::exists(path))
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> data = FileUtils::readBytes(path);
+        if (!cache.checkHeader(data.data(), data.size(), key))
+        {
+            return false;
+        }
+
+        BinaryHeader header{};
+        const size_t offset = DiskCache::HEADER_SIZE + sizeof(BinaryHeader);
+        if (data.size() >= offset)
+        {
+            memcpy(&header, data.data() + DiskCache::HEADER_SIZE, sizeof(BinaryHeader));
+        }
+        if (data.size() < offset || header.length != data.size() - offset)
+        {
+            LOGW("program binary cache truncated: %s", path.c_str());
+            return false;
+        }
+
+        GL_CHECK(glProgramParameteri(programId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        glProgramBinary(programId, header.binaryFormat, data.data() + offset, (GLsizei) header.length);
+
+        // an unsupported format is reported by the link status, not as a GL error
+        while (glGetError() != GL_NO_ERROR) {}
+
+        GLint isLinked = 0;
+        GL_CHECK(glGetProgramiv(programId, GL_LINK_STATUS, &isLinked));
+        if (GL_FALSE == isLinked)
+        {
+            LOGW("program binary cache rejected by driver: %s", path.c_str());
+            return false;
+        }
+
+        LOGD("program binary cache hit: %s", path.c_str());
+        return true;
+    }
+
+    static bool store(uint64_t key, GLuint programId)
+    {
+        if (!enabled())
+        {
+            return false;
+        }
+
+        GLint length = 0;
+        GL_CHECK(glGetProgramiv(programId, GL_PROGRAM_BINARY_LENGTH, &length));
+        if (length <= 0)
+        {
+            return false;
+        }
+
+        std::vector<uint8_t> data;
+        diskCache().writeHeader(data, key);
+        const size_t offset = data.size() + sizeof(BinaryHeader);
+        data.resize(offset + length);
+
+        BinaryHeader header{};
+        GLenum binaryFormat = 0;
+        GL_CHECK(glGetProgramBinary(programId, length, &length, &binaryFormat, data.data() + offset));
+        header.binaryFormat = binaryFormat;
+        header.length = (uint32_t) length;
+        memcpy(data.data() + DiskCache::HEADER_SIZE, &header, sizeof(BinaryHeader));
+        data.resize(offset + length);
+
+        return diskCache().write(key, data);
+    }
+
+private:
+    struct BinaryHeader
+    {
+        uint32_t binaryFormat;
+        uint32_t length;
+    };
+
+    static constexpr uint32_t CACHE_FILE_MAGIC = 0x42505347; // "GSPB"
+
+    static const DiskCache &diskCache()
+    {
+        static const DiskCache cache(SHADER_CACHE_DIR, "bin", CACHE_FILE_MAGIC, PROGRAM_BINARY_CACHE_VERSION, "program binary cache");
+        return cache;
+    }
+
+    static const std::string &getDriverString()
+    {
+        if (s_driver.empty())
+        {
+            auto glString = [](GLenum name) -> std::string {
+                auto *str = (const char *) glGetString(name);
+                return str ? str : "";
+            };
+            s_driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+        }
+        return s_driver;
+    }
+
+private:
+    static bool s_enabled;
+    static std::string s_driver;
+};
+
+bool ProgramBinaryCache::s_enabled = true;
+std::string ProgramBinaryCache::s_driver;
+
+END_NAMESPACE(GLBase)
+
+#endif // _PROGRAM_BINARY_CACHE_HPP_
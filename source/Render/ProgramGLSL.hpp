@@ -6,8 +6,10 @@
 #include <glad/glad.h>
 #include "Common/GLMInc.hpp"
 
+#include "Common/OpenGLExtensions.hpp"
 #include "Common/OpenGLUtils.hpp"
 #include "Render/GLSLUtils.hpp"
+#include "Render/ProgramBinaryCache.hpp"
 
 BEGIN_NAMESPACE(GLBase)
 
@@ -37,6 +39,14 @@ public:
 
     bool loadSource(const std::string &vsSource, const std::string &fsSource)
     {
+        m_binaryKey = ProgramBinaryCache::makeKey({OpenGL_GLSL_VERSION,
+                                                   GLSLPreprocessor::preprocess(vsSource, GL_VERTEX_SHADER),
+                                                   GLSLPreprocessor::preprocess(fsSource, GL_FRAGMENT_SHADER)}, m_defines);
+        if (loadBinary())
+        {
+            return true;
+        }
+
         GLSLUtils vs(GL_VERTEX_SHADER);
         GLSLUtils fs(GL_FRAGMENT_SHADER);
 
@@ -58,6 +68,109 @@ public:
         return loadShader(vs, fs);
     }
 
+    // compile and link are submitted without querying status, call finishAsync once isCompleted
+    bool loadSourceAsync(const std::string &vsSource, const std::string &fsSource)
+    {
+        m_binaryKey = ProgramBinaryCache::makeKey({OpenGL_GLSL_VERSION,
+                                                   GLSLPreprocessor::preprocess(vsSource, GL_VERTEX_SHADER),
+                                                   GLSLPreprocessor::preprocess(fsSource, GL_FRAGMENT_SHADER)}, m_defines);
+        if (loadBinary())
+        {
+            return true;
+        }
+
+        GLSLUtils vs(GL_VERTEX_SHADER);
+        GLSLUtils fs(GL_FRAGMENT_SHADER);
+
+        vs.addDefines(m_defines);
+        fs.addDefines(m_defines);
+
+        if (!vs.compile(vsSource) || !fs.compile(fsSource))
+        {
+            LOGE("ProgramGLSL::loadSourceAsync : submit shader source failed");
+            vs.destroy();
+            fs.destroy();
+            return false;
+        }
+
+        m_id = glCreateProgram();
+        GL_CHECK(glAttachShader(m_id, vs.getId()));
+        GL_CHECK(glAttachShader(m_id, fs.getId()));
+        submitLink();
+
+        m_pendingShaders = {vs, fs};
+        return true;
+    }
+
+    inline bool isCompiling() const
+    {
+        return !m_pendingShaders.empty();
+    }
+
+    // never blocks with KHR_parallel_shader_compile, otherwise the status query in finishAsync waits
+    bool isCompleted() const
+    {
+        if (!isCompiling() || !OpenGLExtensions::hasParallelShaderCompile())
+        {
+            return true;
+        }
+
+        GLint completed = GL_FALSE;
+        GL_CHECK(glGetProgramiv(m_id, GL_COMPLETION_STATUS_KHR, &completed));
+        return GL_TRUE == completed;
+    }
+
+    bool finishAsync()
+    {
+        if (!isCompiling())
+        {
+            return !empty();
+        }
+
+        bool compiled = true;
+        for (auto &shader : m_pendingShaders)
+        {
+            compiled = shader.checkCompileStatus() && compiled;
+        }
+
+        // attached shaders are released together with the program
+        for (auto &shader : m_pendingShaders)
+        {
+            shader.destroy();
+        }
+        m_pendingShaders.clear();
+
+        if (!compiled)
+        {
+            LOGE("ProgramGLSL::finishAsync : compile shader failed");
+            destroy();
+            return false;
+        }
+
+        return checkLinkStatus();
+    }
+
+    bool loadComputeSource(const std::string &csSource)
+    {
+        m_binaryKey = ProgramBinaryCache::makeKey({OpenGL_GLSL_VERSION,
+                                                   GLSLPreprocessor::preprocess(csSource, GL_COMPUTE_SHADER)}, m_defines);
+        if (loadBinary())
+        {
+            return true;
+        }
+
+        GLSLUtils cs(GL_COMPUTE_SHADER);
+        cs.addDefines(m_defines);
+
+        if (!cs.loadSource(csSource))
+        {
+            LOGE("ProgramGLSL::loadComputeSource : load compute shader source failed");
+            return false;
+        }
+
+        return loadShader(cs);
+    }
+
     bool loadFile(const std::string &vsPath, const std::string &fsPath)
     {
         GLSLUtils vs(GL_VERTEX_SHADER);
@@ -112,6 +225,11 @@ public:
         return m_id;
     }
 
+    inline uint64_t getBinaryKey() const
+    {
+        return m_binaryKey;
+    }
+
     void setBool(const std::string &name, bool value) const
     {
         glUniform1i(glGetUniformLocation(m_id, name.c_str()), (int)value);
@@ -143,12 +261,58 @@ public:
     }
 
 private:
+    bool loadBinary()
+    {
+        if (!ProgramBinaryCache::enabled())
+        {
+            return false;
+        }
+
+        m_id = glCreateProgram();
+        if (ProgramBinaryCache::load(m_binaryKey, m_id))
+        {
+            return true;
+        }
+
+        destroy();
+        return false;
+    }
+
     bool loadShader(GLSLUtils &vs, GLSLUtils &fs)
     {
         m_id = glCreateProgram();
         GL_CHECK(glAttachShader(m_id, vs.getId()));
         GL_CHECK(glAttachShader(m_id, fs.getId()));
+
+        return linkProgram();
+    }
+
+    bool loadShader(GLSLUtils &cs)
+    {
+        m_id = glCreateProgram();
+        GL_CHECK(glAttachShader(m_id, cs.getId()));
+
+        return linkProgram();
+    }
+
+    bool linkProgram()
+    {
+        submitLink();
+        return checkLinkStatus();
+    }
+
+    void submitLink()
+    {
+        if (ProgramBinaryCache::enabled())
+        {
+            GL_CHECK(glProgramParameteri(m_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE));
+        }
+
         GL_CHECK(glLinkProgram(m_id));
+    }
+
+    bool checkLinkStatus()
+    {
         GL_CHECK(glValidateProgram(m_id));
 
         GLint isLinked = 0;
@@ -166,12 +330,19 @@ private:
             return false;
         }
 
+        if (m_binaryKey != 0)
+        {
+            ProgramBinaryCache::store(m_binaryKey, m_id);
+        }
+
         return true;
     }
 
 private:
     GLuint m_id = 0;
     std::string m_defines;
+    uint64_t m_binaryKey = 0;
+    std::vector<GLSLUtils> m_pendingShaders;
 };
 
 END_NAMESPACE(GLBase)
@@ -4,14 +4,23 @@
 #include "Common/cpplang.hpp"
 
 #include "Common/HashUtils.hpp"
+#include "Common/ImageUtils.hpp"
+#include "Common/OpenGLExtensions.hpp"
 #include "Config/Config.hpp"
 #include "Model/ModelBase.hpp"
 #include "Render/DemoScene.hpp"
 #include "Render/Framebuffer.hpp"
+#include "Render/GPUDrivenScene.hpp"
+#include "Render/LightClustering.hpp"
 #include "Render/PipelineStates.hpp"
 #include "Render/RenderStates.hpp"
+#include "Render/ShaderCompileQueue.hpp"
 #include "Render/ShaderProgram.hpp"
+#include "Render/ShaderStorageBlock.hpp"
+#include "Render/ShaderVariantPolicy.hpp"
 #include "Render/Texture2D.hpp"
+#include "Render/TextureStreamer.hpp"
+#include "Render/TextureUploader.hpp"
 #include "Render/UniformBlock.hpp"
 #include "Render/UniformSampler.hpp"
 #include "Viewer/Camera.hpp"
@@ -20,9 +29,10 @@ BEGIN_NAMESPACE(GLBase)
 
 #define CREATE_UNIFORM_BLOCK(name) createUniformBlock(#name, sizeof(name))
 
-#define CASE_CREATE_SHADER_GL(shading, source) case shading: \
-  return program.compileAndLinkFile(SHADER_GLSL_DIR + #source + ".vert", \
-                                       SHADER_GLSL_DIR + #source + ".frag")
+#define CASE_SHADER_SOURCES_GL(shading, source) case shading: \
+  variant.vsPath = SHADER_GLSL_DIR + #source + ".vert"; \
+  variant.fsPath = SHADER_GLSL_DIR + #source + ".frag"; \
+  return true
 
 #define GL_STATE_SET(val, gl_state) if (val) glEnable(gl_state); else glDisable(gl_state);
 
@@ -32,6 +42,25 @@ const int SCREEN_HEIGHT = 1024;
 const int SHADOW_MAP_WIDTH = 1024;
 const int SHADOW_MAP_HEIGHT = 1024;
 
+const int LIGHT_TILE_SIZE = 16;
+const int MAX_LIGHTS_PER_TILE = 256;
+
+const int CULLING_GROUP_SIZE = 64;
+const int HIZ_GROUP_SIZE = 8;
+
+enum class RenderPath
+{
+    Forward = 0,
+    Deferred,
+    ForwardClustered,
+};
+
+constexpr char const *CLUSTERED_LIGHTING_DEFINE = "CLUSTERED_LIGHTING";
+constexpr char const *GPU_DRIVEN_DEFINE = "GPU_DRIVEN";
+constexpr char const *PACKED_VERTEX_DEFINE = "PACKED_VERTEX";
+constexpr char const *FALLBACK_DEFINE = "FALLBACK";
+constexpr char const *UBER_SHADER_DEFINE = "UBER_SHADER";
+
 class Renderer
 {
 public:
@@ -51,8 +80,12 @@ public:
         m_uniformBlockScene = CREATE_UNIFORM_BLOCK(UniformsScene);
         m_uniformBlockModel = CREATE_UNIFORM_BLOCK(UniformsModel);
         m_uniformBlockMaterial = CREATE_UNIFORM_BLOCK(UniformsMaterial);
+        m_uniformBlockLights = CREATE_UNIFORM_BLOCK(UniformsLights);
+        m_uniformBlockCulling = CREATE_UNIFORM_BLOCK(UniformsCulling);
 
         m_shadowPlaceholder = createTexture2DDefault(1, 1, TextureFormat::FLOAT32, (int)TextureUsage::Sampler, false);
+
+        ShaderCompileQueue::setMaxCompilerThreads(0xFFFFFFFF);
     }
 
     void destroy()
@@ -60,15 +93,171 @@ public:
         // to do
     }
 
+    void setRenderPath(RenderPath renderPath)
+    {
+        m_renderPath = renderPath;
+    }
+
+    RenderPath getRenderPath() const
+    {
+        return m_renderPath;
+    }
+
+    // opaque meshes are culled on the gpu and drawn with indirect commands
+    void setGPUDriven(bool enable)
+    {
+        m_gpuDriven = enable;
+    }
+
+    bool isGPUDriven() const
+    {
+        return m_gpuDriven;
+    }
+
+    // materials draw with a fallback program until their variant finishes compiling
+    void setAsyncShaderCompile(bool enable)
+    {
+        m_asyncShaderCompile = enable;
+    }
+
+    size_t getPendingShaderCount() const
+    {
+        return m_shaderCompileQueue.pendingCount();
+    }
+
+    // material textures stream through pixel buffers, samplers use placeholders until resident
+    void setAsyncTextureUpload(bool enable)
+    {
+        m_asyncTextureUpload = enable;
+    }
+
+    size_t getPendingTextureCount() const
+    {
+        return m_textureUploader.pendingCount();
+    }
+
+    // mipmapped material textures keep their low mips resident and stream finer ones on demand
+    void setTextureStreaming(bool enable)
+    {
+        m_textureStreaming = enable;
+    }
+
+    void setTextureStreamingBudget(size_t bytes)
+    {
+        m_textureStreamer.setBudget(bytes);
+    }
+
+    size_t getStreamingResidentBytes() const
+    {
+        return m_textureStreamer.getResidentBytes();
+    }
+
+    // vertex buffer layout of the scene meshes, set before create
+    void setVertexFormat(VertexFormat format)
+    {
+        m_vertexFormat = format;
+    }
+
+    // sample color maps with srgb decoding, shading is then in linear space and the
+    // output needs srgb encoding (GL_FRAMEBUFFER_SRGB on an srgb capable framebuffer)
+    void setSRGBTextures(bool enable)
+    {
+        m_srgbTextures = enable;
+    }
+
+    // texture combinations of BlinnPhongWS as specialized programs or one uber shader
+    void setShaderVariantMode(ShaderVariantMode mode)
+    {
+        m_variantPolicy.setMode(mode);
+    }
+
+    ShaderVariantMode getShaderVariantMode() const
+    {
+        return m_variantPolicy.getMode();
+    }
+
+    void setMaxSpecializedVariants(size_t count)
+    {
+        m_variantPolicy.setMaxSpecialized(count);
+    }
+
+    // programs the scene reaches with the current render path, duplicates removed
+    std::vector<ShaderVariant> collectShaderVariants()
+    {
+        std::vector<ShaderVariant> variants;
+        collectMaterialVariant(*m_scene.floor.material, variants);
+        collectMaterialVariant(*m_scene.cube.material, variants);
+        if (m_scene.model != nullptr)
+        {
+            collectModelNodeVariants(m_scene.model->rootNode, variants);
+        }
+
+        if (RenderPath::Deferred == m_renderPath)
+        {
+            variants.push_back(getTiledDeferredVariant());
+        }
+
+        if (m_gpuDriven)
+        {
+            variants.push_back(getCullingVariant());
+            variants.push_back(getHiZVariant(true));
+            variants.push_back(getHiZVariant(false));
+        }
+
+        std::vector<ShaderVariant> uniqueVariants;
+        std::unordered_set<std::string> names;
+        for (auto &variant : variants)
+        {
+            if (names.insert(variant.name()).second)
+            {
+                uniqueVariants.push_back(variant);
+            }
+        }
+        return uniqueVariants;
+    }
+
     void drawFrame()
     {
         setupShadowMapBuffer();
 
+        if (RenderPath::Deferred == m_renderPath && !setupDeferredBuffer())
+        {
+            LOGE("deferred render path not available, fallback to forward");
+            m_renderPath = RenderPath::Forward;
+        }
+
+        if (RenderPath::ForwardClustered == m_renderPath && !setupClusteredLighting())
+        {
+            LOGE("clustered render path not available, fallback to forward");
+            m_renderPath = RenderPath::Forward;
+        }
+
+        if (m_gpuDriven && !setupGPUDriven())
+        {
+            LOGE("gpu driven rendering not available, fallback to cpu submission");
+            m_gpuDriven = false;
+        }
+
         setupScene();
 
+        // every variant of the scene is submitted by now
+        m_shaderCompileQueue.poll(!m_asyncShaderCompile);
+        updateTextureStreaming();
+        m_textureUploader.update();
+
         drawShadowMap();
 
-        drawMainPass();
+        if (RenderPath::Deferred == m_renderPath)
+        {
+            drawDeferredPass();
+        }
+        else
+        {
+            drawMainPass();
+        }
+
+        // promoted variants switch programs in the next setupScene
+        m_variantPolicy.endFrame();
     }
 
     void setupShadowMapBuffer()
@@ -108,11 +297,203 @@ public:
         }
     }
 
+    bool setupDeferredBuffer()
+    {
+        if (!OpenGLExtensions::hasComputeShader())
+        {
+            return false;
+        }
+
+        if (nullptr == m_fboGBuffer)
+        {
+            m_fboGBuffer = createFramebuffer(true);
+
+            std::vector<std::shared_ptr<Texture>> colors;
+            colors.push_back(m_texGBufferAlbedo = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::RGBA8, (int)TextureUsage::Sampler | (int)TextureUsage::AttachmentColor, false));
+            colors.push_back(m_texGBufferNormal = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::RGBA16F, (int)TextureUsage::Sampler | (int)TextureUsage::AttachmentColor, false));
+            colors.push_back(m_texGBufferPosition = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::RGBA32F, (int)TextureUsage::Sampler | (int)TextureUsage::AttachmentColor, false));
+            colors.push_back(m_texGBufferEmissive = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::RGBA8, (int)TextureUsage::Sampler | (int)TextureUsage::AttachmentColor, false));
+            m_fboGBuffer->setColorAttachments(colors);
+
+            m_texGBufferDepth = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::FLOAT32, (int)TextureUsage::AttachmentDepth, false);
+            m_fboGBuffer->setDepthAttachment(m_texGBufferDepth);
+
+            if (!m_fboGBuffer->isValid())
+            {
+                LOGE("setupDeferredBuffer failed: g-buffer incomplete");
+                return false;
+            }
+        }
+
+        if (nullptr == m_fboDeferred)
+        {
+            // lit output, transparent meshes are blended on top of it with the g-buffer depth
+            m_fboDeferred = createFramebuffer(true);
+            m_texDeferredOutput = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::RGBA16F, (int)TextureUsage::AttachmentColor | (int)TextureUsage::RendererOutput, false);
+            m_fboDeferred->setColorAttachment(m_texDeferredOutput, 0);
+            m_fboDeferred->setDepthAttachment(m_texGBufferDepth);
+
+            if (!m_fboDeferred->isValid())
+            {
+                LOGE("setupDeferredBuffer failed: output incomplete");
+                return false;
+            }
+        }
+
+        if (nullptr == m_programTiledDeferred)
+        {
+            auto program = createShaderProgram();
+            if (!program->compileAndLinkVariant(getTiledDeferredVariant()))
+            {
+                LOGE("setupDeferredBuffer failed: compile TiledDeferred.comp");
+                return false;
+            }
+            m_programTiledDeferred = program;
+
+            setupPointLightsBlock();
+
+            auto resources = std::make_shared<ShaderResources>();
+            resources->blocks[(int)UniformBlockType::Scene] = m_uniformBlockScene;
+            resources->blocks[(int)UniformBlockType::Lights] = m_uniformBlockLights;
+            resources->storageBlocks[(int)StorageBlockType::PointLights] = m_storageBlockPointLights;
+            setupSampler(*resources, MaterialTexType::GBUFFER_ALBEDO, m_texGBufferAlbedo);
+            setupSampler(*resources, MaterialTexType::GBUFFER_NORMAL, m_texGBufferNormal);
+            setupSampler(*resources, MaterialTexType::GBUFFER_POSITION, m_texGBufferPosition);
+            setupSampler(*resources, MaterialTexType::GBUFFER_EMISSIVE, m_texGBufferEmissive);
+            setupSampler(*resources, MaterialTexType::SHADOWMAP, m_texDepthShadow);
+            m_resourcesTiledDeferred = resources;
+        }
+
+        return true;
+    }
+
+    bool setupClusteredLighting()
+    {
+        if (!OpenGLExtensions::hasShaderStorageBuffer())
+        {
+            return false;
+        }
+
+        if (nullptr == m_lightClustering)
+        {
+            m_lightClustering = std::make_shared<LightClustering>();
+            m_storageBlockClusterGrid = createShaderStorageBlock("ClusterLightGrid", sizeof(glm::uvec2));
+            m_storageBlockClusterIndices = createShaderStorageBlock("ClusterLightIndices", sizeof(uint32_t));
+            setupPointLightsBlock();
+        }
+
+        return true;
+    }
+
+    bool setupGPUDriven()
+    {
+        if (!OpenGLExtensions::hasIndirectDraw())
+        {
+            return false;
+        }
+
+        if (nullptr == m_programCulling)
+        {
+            auto program = createShaderProgram();
+            if (!program->compileAndLinkVariant(getCullingVariant()))
+            {
+                LOGE("setupGPUDriven failed: compile GPUCulling.comp");
+                return false;
+            }
+
+            auto programHiZCopy = createShaderProgram();
+            auto programHiZReduce = createShaderProgram();
+            if (!programHiZCopy->compileAndLinkVariant(getHiZVariant(true))
+                || !programHiZReduce->compileAndLinkVariant(getHiZVariant(false)))
+            {
+                LOGE("setupGPUDriven failed: compile HiZBuild.comp");
+                return false;
+            }
+
+            m_programCulling = program;
+            m_programHiZCopy = programHiZCopy;
+            m_programHiZReduce = programHiZReduce;
+        }
+
+        if (nullptr == m_gpuDrivenScene)
+        {
+            auto scene = std::make_shared<GPUDrivenScene>();
+            if (isIndirectDrawMesh(m_scene.floor))
+            {
+                scene->addMesh(m_scene.floor, m_scene.floor.transform, false);
+            }
+            if (isIndirectDrawMesh(m_scene.cube))
+            {
+                scene->addMesh(m_scene.cube, m_scene.cube.transform, true);
+            }
+            addModelNodeIndirect(*scene, m_scene.model->rootNode);
+            if (!scene->build(m_vertexFormat))
+            {
+                LOGE("setupGPUDriven failed: no opaque meshes");
+                return false;
+            }
+            m_gpuDrivenScene = scene;
+
+            // main pass goes offscreen so its depth can be reduced into the hi-z pyramid
+            m_fboMain = createFramebuffer(true);
+            m_texMainColor = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::RGBA8, (int)TextureUsage::AttachmentColor | (int)TextureUsage::RendererOutput, false);
+            m_texMainDepth = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::FLOAT32, (int)TextureUsage::Sampler | (int)TextureUsage::AttachmentDepth, false);
+            m_fboMain->setColorAttachment(m_texMainColor, 0);
+            m_fboMain->setDepthAttachment(m_texMainDepth);
+            if (!m_fboMain->isValid())
+            {
+                LOGE("setupGPUDriven failed: main framebuffer incomplete");
+                return false;
+            }
+
+            m_texHiZ = createTexture2DDefault(SCREEN_WIDTH, SCREEN_HEIGHT, TextureFormat::R32F, (int)TextureUsage::Sampler, true);
+            m_hizMipCount = (int) std::floor(std::log2(std::max(SCREEN_WIDTH, SCREEN_HEIGHT))) + 1;
+
+            auto resourcesCulling = std::make_shared<ShaderResources>();
+            resourcesCulling->blocks[(int)UniformBlockType::Culling] = m_uniformBlockCulling;
+            resourcesCulling->storageBlocks[(int)StorageBlockType::DrawInstances] = scene->getInstancesBlock();
+            resourcesCulling->storageBlocks[(int)StorageBlockType::DrawBatches] = scene->getBatchesBlock();
+            resourcesCulling->storageBlocks[(int)StorageBlockType::DrawCommands] = scene->getCommandsBlock();
+            setupSampler(*resourcesCulling, MaterialTexType::HIZ, m_texHiZ);
+            m_resourcesCulling = resourcesCulling;
+
+            m_resourcesHiZCopy = std::make_shared<ShaderResources>();
+            setupSampler(*m_resourcesHiZCopy, MaterialTexType::DEPTH, m_texMainDepth);
+            m_resourcesHiZReduce = std::make_shared<ShaderResources>();
+        }
+
+        return true;
+    }
+
+    void addModelNodeIndirect(GPUDrivenScene &scene, ModelNode &node)
+    {
+        for (auto &mesh : node.meshes)
+        {
+            if (isIndirectDrawMesh(mesh))
+            {
+                scene.addMesh(mesh, node.transform, true);
+            }
+        }
+
+        for (auto &child : node.children)
+        {
+            addModelNodeIndirect(scene, child);
+        }
+    }
+
+    void setupPointLightsBlock()
+    {
+        if (nullptr == m_storageBlockPointLights)
+        {
+            m_storageBlockPointLights = createShaderStorageBlock("PointLights", sizeof(PointLight));
+        }
+    }
+
     void setupScene()
     {
-        pipelineSetup(m_scene.floor, m_scene.floor.material->shadingModel, {(int)GLBase::UniformBlockType::Scene, (int)GLBase::UniformBlockType::Model, (int)GLBase::UniformBlockType::Material});
+        pipelineSetup(m_scene.floor, getShadingModel(*m_scene.floor.material), {(int)GLBase::UniformBlockType::Scene, (int)GLBase::UniformBlockType::Model, (int)GLBase::UniformBlockType::Material});
 
-        pipelineSetup(m_scene.cube, m_scene.cube.material->shadingModel, {(int)GLBase::UniformBlockType::Scene, (int)GLBase::UniformBlockType::Model, (int)GLBase::UniformBlockType::Material});
+        pipelineSetup(m_scene.cube, getShadingModel(*m_scene.cube.material), {(int)GLBase::UniformBlockType::Scene, (int)GLBase::UniformBlockType::Model, (int)GLBase::UniformBlockType::Material});
 
         setupModelNode(m_scene.model->rootNode);
     }
@@ -121,27 +502,121 @@ public:
     {
         updateUniformScene();
 
-        if (!shadowPass)
+        drawSceneOpaque(shadowPass);
+
+        drawSceneTransparent(shadowPass);
+    }
+
+private:
+    void drawSceneOpaque(bool shadowPass)
+    {
+        if (m_gpuDriven)
+        {
+            drawSceneIndirect(shadowPass);
+        }
+
+        if (!shadowPass && !isIndirectDrawMesh(m_scene.floor))
         {
-            updateUniformModel(m_scene.floor.transform, m_cameraCurrent->getViewMatrix());
+            updateUniformModel(m_scene.floor.transform, m_cameraCurrent->getViewMatrix(), m_scene.floor.positionDecode);
             drawModelMesh(m_scene.floor, shadowPass, 0.5f);
         }
 
-        updateUniformModel(m_scene.cube.transform, m_cameraCurrent->getViewMatrix());
-        drawModelMesh(m_scene.cube, shadowPass, 0.5f);
+        if (!isIndirectDrawMesh(m_scene.cube))
+        {
+            updateUniformModel(m_scene.cube.transform, m_cameraCurrent->getViewMatrix(), m_scene.cube.positionDecode);
+            drawModelMesh(m_scene.cube, shadowPass, 0.5f);
+        }
 
-        ModelNode &rootNode = m_scene.model->rootNode;
-        drawModelNode(rootNode, shadowPass, AlphaMode::Opaque);
+        drawModelNode(m_scene.model->rootNode, shadowPass, AlphaMode::Opaque);
+    }
 
-        drawModelNode(rootNode, shadowPass, AlphaMode::Blend);
+    void drawSceneTransparent(bool shadowPass)
+    {
+        drawModelNode(m_scene.model->rootNode, shadowPass, AlphaMode::Blend);
+    }
+
+    // texel density of the meshes in the main camera frustum drives the streamed mip levels
+    void updateTextureStreaming()
+    {
+        if (!m_textureStreaming)
+        {
+            return;
+        }
+
+        glm::mat4 viewProjection = m_cameraMain->getPerspectiveMatrix() * m_cameraMain->getViewMatrix();
+        float projScale = (float) SCREEN_HEIGHT * 0.5f * m_cameraMain->getPerspectiveMatrix()[1][1];
+
+        requestMeshTextures(m_scene.floor, m_scene.floor.transform, viewProjection, projScale);
+        requestMeshTextures(m_scene.cube, m_scene.cube.transform, viewProjection, projScale);
+        requestModelNodeTextures(m_scene.model->rootNode, viewProjection, projScale);
+
+        m_textureStreamer.update(m_textureUploader);
+    }
+
+    void requestModelNodeTextures(ModelNode &node, const glm::mat4 &viewProjection, float projScale)
+    {
+        for (auto &mesh : node.meshes)
+        {
+            requestMeshTextures(mesh, node.transform, viewProjection, projScale);
+        }
+
+        for (auto &child : node.children)
+        {
+            requestModelNodeTextures(child, viewProjection, projScale);
+        }
+    }
+
+    void requestMeshTextures(ModelMesh &mesh, const glm::mat4 &transform, const glm::mat4 &viewProjection, float projScale)
+    {
+        auto it = m_meshTexelDensity.find(&mesh);
+        if (it == m_meshTexelDensity.end())
+        {
+            it = m_meshTexelDensity.insert({&mesh, TextureStreamer::computeDensity(mesh)}).first;
+        }
+        auto &density = it->second;
+
+        float scale = std::max(glm::length(glm::vec3(transform[0])), std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+        glm::vec3 center = glm::vec3(transform * glm::vec4(density.center, 1.0f));
+        float radius = density.radius * scale;
+        if (!isSphereInFrustum(center, radius, viewProjection))
+        {
+            return;
+        }
+
+        float distance = std::max(glm::length(center - m_cameraMain->position()) - radius, m_cameraMain->near());
+        for (auto &kv : mesh.material->textures)
+        {
+            if (m_textureStreamer.isStreamed(kv.second.get()))
+            {
+                float level = TextureStreamer::computeMipLevel(*kv.second, density.uvDensity / scale, distance, projScale);
+                m_textureStreamer.requestLevel(kv.second.get(), level);
+            }
+        }
+    }
+
+    static bool isSphereInFrustum(const glm::vec3 &center, float radius, const glm::mat4 &viewProjection)
+    {
+        glm::mat4 rows = glm::transpose(viewProjection);
+        for (int i = 0; i < 3; i++)
+        {
+            for (float sign : {1.0f, -1.0f})
+            {
+                glm::vec4 plane = rows[3] + sign * rows[i];
+                plane /= glm::length(glm::vec3(plane));
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
     }
 
-private:
     void setupModelNode(ModelNode &node)
     {
         for (auto &mesh : node.meshes)
         {
-            pipelineSetup(mesh, mesh.material->shadingModel, {(int)UniformBlockType::Scene, (int)UniformBlockType::Model, (int)UniformBlockType::Material});
+            pipelineSetup(mesh, getShadingModel(*mesh.material), {(int)UniformBlockType::Scene, (int)UniformBlockType::Model, (int)UniformBlockType::Material});
         }
 
         for (auto &child : node.children)
@@ -154,13 +629,12 @@ private:
     {
         glm::mat4 modelMatrix = node.transform;
 
-        updateUniformModel(modelMatrix, m_cameraCurrent->getViewMatrix());
-
         for(auto &mesh : node.meshes)
         {
-            if(mesh.material->alphaMode != mode)
+            if(mesh.material->alphaMode != mode || isIndirectDrawMesh(mesh))
                 continue;
 
+            updateUniformModel(modelMatrix, m_cameraCurrent->getViewMatrix(), mesh.positionDecode);
             drawModelMesh(mesh, shadowPass, 0.5f);
         }
 
@@ -199,33 +673,192 @@ private:
         // set vao
         setVertexArrayObject(model.vao);
 
-        // set shader program
-        setShaderProgram(model.material->materialObj->shaderProgram);
+        // set shader program
+        setShaderProgram(getMaterialProgram(*model.material->materialObj));
+        m_variantPolicy.recordDraw(model.material->materialObj->variantKey);
+
+        // set shader resources
+        setShaderResources(model.material->materialObj->shaderResources);
+
+        // set pipeline states
+        setPipelineStates(model.material->materialObj->pipelineStates);
+
+        // draw
+        glDrawElements(GL_TRIANGLES, (GLsizei) model.vao->getIndicesCount(), model.vao->getIndexType(), nullptr);
+    }
+
+    void drawSceneIndirect(bool shadowPass)
+    {
+        cullInstances(shadowPass);
+
+        // per draw transforms are read from the instance buffer
+        updateUniformModel(glm::mat4(1.0f), m_cameraCurrent->getViewMatrix());
+
+        for (auto &batch : m_gpuDrivenScene->getBatches())
+        {
+            auto &material = *batch.material;
+            if (nullptr == material.materialObj)
+                continue;
+
+            updateUniformMaterial(material, 0.5f);
+            updateShadowTextures(material.materialObj.get(), shadowPass);
+            pipelineDrawIndirect(batch);
+        }
+    }
+
+    void pipelineDrawIndirect(const IndirectBatch &batch)
+    {
+        auto &materialObj = *batch.material->materialObj;
+
+        setVertexArrayObject(m_gpuDrivenScene->getVertexArrayObject());
+        setShaderProgram(getMaterialProgram(materialObj));
+        m_variantPolicy.recordDraw(materialObj.variantKey);
+        setShaderResources(materialObj.shaderResources);
+        setPipelineStates(materialObj.pipelineStates);
+
+        m_gpuDrivenScene->drawBatch(batch);
+    }
+
+    void cullInstances(bool shadowPass)
+    {
+        m_gpuDrivenScene->resetCommands();
+
+        static UniformsCulling uniformCulling{};
+
+        glm::mat4 viewProjection = m_cameraCurrent->getPerspectiveMatrix() * m_cameraCurrent->getViewMatrix();
+        uniformCulling.u_cullViewProjection = viewProjection;
+        uniformCulling.u_hizViewProjection = m_hizViewProjection;
+        // planes from the rows of the view projection matrix
+        glm::mat4 rows = glm::transpose(viewProjection);
+        for (int i = 0; i < 3; i++)
+        {
+            uniformCulling.u_frustumPlanes[i * 2 + 0] = rows[3] + rows[i];
+            uniformCulling.u_frustumPlanes[i * 2 + 1] = rows[3] - rows[i];
+        }
+        for (auto &plane : uniformCulling.u_frustumPlanes)
+        {
+            plane /= glm::length(glm::vec3(plane));
+        }
+
+        bool occlusion = !shadowPass && m_hizValid;
+        uniformCulling.u_cullParams = glm::ivec4((int)m_gpuDrivenScene->getInstanceCount(), shadowPass ? 1 : 0, occlusion ? 1 : 0, m_hizMipCount);
+        uniformCulling.u_cullCameraPos = glm::vec4(m_cameraCurrent->position(), 1.0f);
+        m_uniformBlockCulling->setData(&uniformCulling, sizeof(UniformsCulling));
+
+        setShaderProgram(m_programCulling);
+        setShaderResources(m_resourcesCulling);
+        glDispatchCompute((GLuint)(m_gpuDrivenScene->getInstanceCount() + CULLING_GROUP_SIZE - 1) / CULLING_GROUP_SIZE, 1, 1);
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+    }
+
+    // max depth pyramid of this frame, used for occlusion culling in the next frame
+    void buildHiZ(std::shared_ptr<Texture> &depthTexture)
+    {
+        m_resourcesHiZCopy->samplers[(int)MaterialTexType::DEPTH]->setTexture(depthTexture);
+
+        for (int level = 0; level < m_hizMipCount; level++)
+        {
+            int width = (int) m_texHiZ->getLevelWidth(level);
+            int height = (int) m_texHiZ->getLevelHeight(level);
+
+            if (0 == level)
+            {
+                setShaderProgram(m_programHiZCopy);
+                setShaderResources(m_resourcesHiZCopy);
+            }
+            else
+            {
+                setShaderProgram(m_programHiZReduce);
+                setShaderResources(m_resourcesHiZReduce);
+                glBindImageTexture(0, m_texHiZ->getId(), level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+            }
+            glBindImageTexture(1, m_texHiZ->getId(), level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            glDispatchCompute((width + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, (height + HIZ_GROUP_SIZE - 1) / HIZ_GROUP_SIZE, 1);
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        m_hizViewProjection = m_cameraMain->getPerspectiveMatrix() * m_cameraMain->getViewMatrix();
+        m_hizValid = true;
+    }
+
+    void drawMainPass()
+    {
+        ClearStates clearStates{};
+        clearStates.colorFlag = true;
+        clearStates.depthFlag = true;
+        clearStates.clearColor = glm::vec4(0.2f, 0.3f, 0.3f, 1.0f);
+        clearStates.clearDepth = 1.0f;
+
+        if (m_gpuDriven)
+        {
+            beginRenderPass(m_fboMain, clearStates);
+        }
+        else
+        {
+            beginRenderPass(clearStates);
+        }
+        setViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-        // set shader resources
-        setShaderResources(model.material->materialObj->shaderResources);
+        if (RenderPath::ForwardClustered == m_renderPath)
+        {
+            updateClusteredLights();
+        }
 
-        // set pipeline states
-        setPipelineStates(model.material->materialObj->pipelineStates);
+        drawScene(false);
 
-        // draw
-        glDrawElements(GL_TRIANGLES, (GLsizei) model.vao->getIndicesCount(), GL_UNSIGNED_INT, nullptr);
+        endRenderPass();
+
+        if (m_gpuDriven)
+        {
+            blitToScreen(m_fboMain, SCREEN_WIDTH, SCREEN_HEIGHT);
+            buildHiZ(m_texMainDepth);
+        }
     }
 
-    void drawMainPass()
+    void drawDeferredPass()
     {
+        // geometry pass
         ClearStates clearStates{};
         clearStates.colorFlag = true;
         clearStates.depthFlag = true;
-        clearStates.clearColor = glm::vec4(0.2f, 0.3f, 0.3f, 1.0f);
+        clearStates.clearColor = glm::vec4(0.0f);
         clearStates.clearDepth = 1.0f;
 
-        beginRenderPass(clearStates);
+        beginRenderPass(m_fboGBuffer, clearStates);
         setViewport(0, 0, SCREEN_WIDTH, SCREEN_HEIGHT);
 
-        drawScene(false);
+        updateUniformScene();
+        drawSceneOpaque(false);
+
+        endRenderPass();
+
+        if (m_gpuDriven)
+        {
+            buildHiZ(m_texGBufferDepth);
+        }
+
+        // light culling and shading per tile
+        ClearStates outputClearStates{};
+        outputClearStates.colorFlag = true;
+        outputClearStates.clearColor = glm::vec4(0.2f, 0.3f, 0.3f, 1.0f);
+        beginRenderPass(m_fboDeferred, outputClearStates);
+
+        updateUniformLights();
+        m_storageBlockPointLights->setData(m_scene.pointLights.data(), (int)(m_scene.pointLights.size() * sizeof(PointLight)));
+
+        setShaderProgram(m_programTiledDeferred);
+        setShaderResources(m_resourcesTiledDeferred);
+        glBindImageTexture(0, m_texDeferredOutput->getId(), 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA16F);
+        glDispatchCompute((SCREEN_WIDTH + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE, (SCREEN_HEIGHT + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE, 1);
+        glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT);
+
+        // forward shading for transparent meshes
+        drawSceneTransparent(false);
 
         endRenderPass();
+
+        blitToScreen(m_fboDeferred, SCREEN_WIDTH, SCREEN_HEIGHT);
     }
 
     void drawShadowMap()
@@ -285,6 +918,14 @@ private:
         glClear(clearBit);
     }
 
+    void blitToScreen(std::shared_ptr<Framebuffer> &fbo, int width, int height)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, fbo->getId());
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
     void endRenderPass()
     {
         glDisable(GL_BLEND);
@@ -303,7 +944,19 @@ private:
     {
         if (nullptr == model.vao)
         {
+            if (model.vertexFormat != m_vertexFormat)
+            {
+                model.InitVertexArray(m_vertexFormat);
+            }
             model.vao = std::make_shared<VertexArrayObject>(model);
+
+            // the gpu driven merge ran in setupGPUDriven already, streaming only needs the density,
+            // after that nothing reads the mapped cache mesh on the cpu
+            if (m_textureStreaming && m_meshTexelDensity.find(&model) == m_meshTexelDensity.end())
+            {
+                m_meshTexelDensity.insert({&model, TextureStreamer::computeDensity(model)});
+            }
+            model.ReleaseMapping();
         }
     }
 
@@ -316,10 +969,23 @@ private:
             material.shaderDefines = generateShaderDefines(material);
         }
 
+        std::set<std::string> shaderDefines = getShaderDefines(material, shadingModel);
+        size_t variantKey = getShaderProgramCacheKey(shadingModel, shaderDefines);
+        if (useUberShader(shadingModel, variantKey))
+        {
+            shaderDefines = getUberShaderDefines(material, shaderDefines);
+        }
+
+        if (material.materialObj != nullptr && material.materialObj->shaderDefines != shaderDefines)
+        {
+            material.materialObj = nullptr;
+        }
+
         if (nullptr == material.materialObj)
         {
             material.materialObj = std::make_shared<MaterialObject>();
             material.materialObj->shadingModel = shadingModel;
+            material.materialObj->shaderDefines = shaderDefines;
 
             if (setupShaderProgram(material, shadingModel))
             {
@@ -348,11 +1014,34 @@ private:
                     material.materialObj->shaderResources->blocks[key] = uniform;
                 }
             }
+
+            if (shaderDefines.count(GPU_DRIVEN_DEFINE) > 0)
+            {
+                auto &resources = *material.materialObj->shaderResources;
+                resources.storageBlocks[(int)StorageBlockType::DrawInstances] = m_gpuDrivenScene->getInstancesBlock();
+            }
+
+            if (shaderDefines.count(CLUSTERED_LIGHTING_DEFINE) > 0)
+            {
+                auto &resources = *material.materialObj->shaderResources;
+                resources.blocks[(int)UniformBlockType::Lights] = m_uniformBlockLights;
+                resources.storageBlocks[(int)StorageBlockType::PointLights] = m_storageBlockPointLights;
+                resources.storageBlocks[(int)StorageBlockType::ClusterLightGrid] = m_storageBlockClusterGrid;
+                resources.storageBlocks[(int)StorageBlockType::ClusterLightIndices] = m_storageBlockClusterIndices;
+            }
         }
+        material.materialObj->variantKey = variantKey;
+        updateResidentTextures(material);
 
         setupPipelineStates(model);
     }
 
+    // srgb formats fall back to their linear layout unless srgb sampling is enabled
+    TextureFormat resolveTextureFormat(TextureFormat format) const
+    {
+        return m_srgbTextures ? format : Texture::getLinearFormat(format);
+    }
+
     void setupTextures(Material &material)
     {
         for(auto &kv : material.textureData)
@@ -360,16 +1049,48 @@ private:
             TextureDesc texDesc{};
             texDesc.width = kv.second.width;
             texDesc.height = kv.second.height;
-            texDesc.format = TextureFormat::RGBA8;
+            texDesc.format = resolveTextureFormat(kv.second.format);
             texDesc.usage = (int)TextureUsage::Sampler | (int)TextureUsage::UploadData;
             texDesc.useMipmaps = true;
             texDesc.multiSample = false;
 
+            // compressed chains are small enough to upload at once, they bypass streaming and the uploader
+            auto &compressed = kv.second.compressed;
+            bool srgb = Texture::getLinearFormat(kv.second.format) != kv.second.format;
+            TextureFormat compressedFormat = TextureFormat::RGBA8;
+            if (compressed != nullptr)
+            {
+                compressedFormat = resolveTextureFormat(srgb ? Texture::getSRGBFormat(compressed->format) : compressed->format);
+            }
+            bool useCompressed = compressed != nullptr && Texture::isFormatSupported(compressedFormat);
+            if (useCompressed)
+            {
+                texDesc.format = compressedFormat;
+            }
+
             SamplerDesc sampler{};
             sampler.wrapS = kv.second.wrapModeU;
             sampler.wrapT = kv.second.wrapModeV;
             sampler.filterMin = FilterMode::LINEAR_MIPMAP_LINEAR;
-            sampler.filterMag = FilterMode::LINEAR_MIPMAP_LINEAR;
+            sampler.filterMag = FilterMode::LINEAR;
+
+            // materials sharing a decoded or compressed image share the texture
+            size_t cacheKey = 0;
+            HashUtils::hashCombine(cacheKey, kv.second.data.empty() ? nullptr : kv.second.data[0].get());
+            HashUtils::hashCombine(cacheKey, useCompressed ? compressed.get() : nullptr);
+            HashUtils::hashCombine(cacheKey, (int) texDesc.format);
+            HashUtils::hashCombine(cacheKey, (int) sampler.wrapS);
+            HashUtils::hashCombine(cacheKey, (int) sampler.wrapT);
+            auto cachedTexture = m_textureCache.find(cacheKey);
+            if (cachedTexture != m_textureCache.end())
+            {
+                auto texture = cachedTexture->second.lock();
+                if (texture != nullptr)
+                {
+                    material.textures[kv.first] = texture;
+                    continue;
+                }
+            }
 
             std::shared_ptr<Texture> texture = nullptr;
             switch(kv.first)
@@ -381,9 +1102,31 @@ private:
             }
             texture = createTexture(texDesc);
             texture->setSamplerDesc(sampler);
-            texture->setImageData(kv.second.data);
+            if (kv.second.maxLevel >= 0)
+            {
+                // a short chain never streams, it is complete once the levels past it are cut off
+                texture->setLevelRange(0, (uint32_t) kv.second.maxLevel);
+            }
+            if (useCompressed)
+            {
+                texture->setCompressedImageData(*compressed);
+            }
+            else if (m_textureStreaming && texDesc.useMipmaps && kv.second.data.size() == texture->getLevelCount())
+            {
+                m_textureStreamer.registerTexture(texture, kv.second.data);
+            }
+            else if (m_asyncTextureUpload)
+            {
+                texture->initImageData();
+                m_textureUploader.upload(texture, kv.second.data);
+            }
+            else
+            {
+                texture->setImageData(kv.second.data);
+            }
             texture->tag = kv.second.tag;
             material.textures[kv.first] = texture;
+            m_textureCache[cacheKey] = texture;
         }
 
         if (material.shadingModel != ShadingModel::Skybox)
@@ -394,25 +1137,34 @@ private:
 
     bool setupShaderProgram(Material &material, ShadingModel shadingModel)
     {
-        size_t cacheKey = getShaderProgramCacheKey(shadingModel, material.shaderDefines);
+        auto &shaderDefines = material.materialObj->shaderDefines;
+        size_t cacheKey = getShaderProgramCacheKey(shadingModel, shaderDefines);
 
         auto cachedProgram = m_programCache.find(cacheKey);
         if (cachedProgram != m_programCache.end())
         {
             material.materialObj->shaderProgram = cachedProgram->second;
             material.materialObj->shaderResources = std::make_shared<ShaderResources>();
+            if (cachedProgram->second->isCompiling())
+            {
+                material.materialObj->fallbackProgram = getMaterialFallbackProgram(material, shadingModel);
+            }
             return true;
         }
 
         auto program = createShaderProgram();
-        program->addDefines(material.shaderDefines);
+        program->addDefines(shaderDefines);
 
-        bool success = loadShaders(*program, shadingModel);
+        bool success = loadShaders(program, shadingModel);
         if (success)
         {
             m_programCache[cacheKey] = program;
             material.materialObj->shaderProgram = program;
             material.materialObj->shaderResources = std::make_shared<ShaderResources>();
+            if (program->isCompiling())
+            {
+                material.materialObj->fallbackProgram = getMaterialFallbackProgram(material, shadingModel);
+            }
         }
         else
         {
@@ -422,6 +1174,13 @@ private:
         return success;
     }
 
+    void setupSampler(ShaderResources &resources, MaterialTexType texType, std::shared_ptr<Texture> &texture)
+    {
+        auto uniform = createUniformSampler(Material::samplerName(texType), *texture);
+        uniform->setTexture(texture);
+        resources.samplers[(int)texType] = std::move(uniform);
+    }
+
     void setupSamplerUniforms(Material &material)
     {
         for (auto &kv : material.textures)
@@ -436,13 +1195,90 @@ private:
         }
     }
 
-    bool loadShaders(ShaderProgram &program, ShadingModel shadingModel)
+    // BasicGLSL with the defines that change the vertex input or the texture set
+    ShaderVariant getFallbackVariant(const std::set<std::string> &shaderDefines)
+    {
+        ShaderVariant variant;
+        getShaderSources(ShadingModel::BaseColor, variant);
+        variant.defines.insert(FALLBACK_DEFINE);
+        for (auto *define : {GPU_DRIVEN_DEFINE, PACKED_VERTEX_DEFINE, "ALBEDO_MAP"})
+        {
+            if (shaderDefines.count(define) > 0)
+            {
+                variant.defines.insert(define);
+            }
+        }
+        return variant;
+    }
+
+    std::shared_ptr<ShaderProgram> getFallbackProgram(const std::set<std::string> &shaderDefines)
+    {
+        ShaderVariant variant = getFallbackVariant(shaderDefines);
+        size_t cacheKey = getShaderProgramCacheKey(ShadingModel::BaseColor, variant.defines);
+        auto cachedProgram = m_fallbackProgramCache.find(cacheKey);
+        if (cachedProgram != m_fallbackProgramCache.end())
+        {
+            return cachedProgram->second;
+        }
+
+        auto program = createShaderProgram();
+        if (!program->compileAndLinkVariant(variant))
+        {
+            LOGE("compile fallback program failed");
+            program = nullptr;
+        }
+
+        m_fallbackProgramCache[cacheKey] = program;
+        return program;
+    }
+
+    // a promoted variant keeps drawing with the uber shader until it is compiled
+    std::shared_ptr<ShaderProgram> getMaterialFallbackProgram(Material &material, ShadingModel shadingModel)
+    {
+        auto &shaderDefines = material.materialObj->shaderDefines;
+        if (supportsUberShader(shadingModel) && shaderDefines.count(UBER_SHADER_DEFINE) == 0)
+        {
+            size_t uberKey = getShaderProgramCacheKey(shadingModel, getUberShaderDefines(material, shaderDefines));
+            auto uberProgram = m_programCache.find(uberKey);
+            if (uberProgram != m_programCache.end() && uberProgram->second->isReady())
+            {
+                return uberProgram->second;
+            }
+        }
+
+        return getFallbackProgram(shaderDefines);
+    }
+
+    std::shared_ptr<ShaderProgram> &getMaterialProgram(MaterialObject &materialObj)
+    {
+        if (materialObj.shaderProgram != nullptr && !materialObj.shaderProgram->isReady()
+            && materialObj.fallbackProgram != nullptr)
+        {
+            return materialObj.fallbackProgram;
+        }
+
+        return materialObj.shaderProgram;
+    }
+
+    bool loadShaders(std::shared_ptr<ShaderProgram> &program, ShadingModel shadingModel)
+    {
+        ShaderVariant variant;
+        if (!getShaderSources(shadingModel, variant))
+        {
+            return false;
+        }
+
+        return m_shaderCompileQueue.submit(program, variant.vsPath, variant.fsPath);
+    }
+
+    bool getShaderSources(ShadingModel shadingModel, ShaderVariant &variant)
     {
         switch (shadingModel)
         {
-            CASE_CREATE_SHADER_GL(ShadingModel::BaseColor, BasicGLSL);
-            CASE_CREATE_SHADER_GL(ShadingModel::BlinnPhong, BlinnPhongWS);
-            CASE_CREATE_SHADER_GL(ShadingModel::PBR, BlinnPhongWS);
+            CASE_SHADER_SOURCES_GL(ShadingModel::BaseColor, BasicGLSL);
+            CASE_SHADER_SOURCES_GL(ShadingModel::BlinnPhong, BlinnPhongWS);
+            CASE_SHADER_SOURCES_GL(ShadingModel::PBR, BlinnPhongWS);
+            CASE_SHADER_SOURCES_GL(ShadingModel::GBuffer, GBuffer);
             default:
                 break;
         }
@@ -450,6 +1286,155 @@ private:
         return false;
     }
 
+    ShaderVariant getTiledDeferredVariant()
+    {
+        ShaderVariant variant;
+        variant.csPath = SHADER_GLSL_DIR + "TiledDeferred.comp";
+        variant.defines.insert("TILE_SIZE " + std::to_string(LIGHT_TILE_SIZE));
+        variant.defines.insert("MAX_LIGHTS_PER_TILE " + std::to_string(MAX_LIGHTS_PER_TILE));
+        return variant;
+    }
+
+    ShaderVariant getCullingVariant()
+    {
+        ShaderVariant variant;
+        variant.csPath = SHADER_GLSL_DIR + "GPUCulling.comp";
+        variant.defines.insert("CULLING_GROUP_SIZE " + std::to_string(CULLING_GROUP_SIZE));
+        return variant;
+    }
+
+    ShaderVariant getHiZVariant(bool copyDepth)
+    {
+        ShaderVariant variant;
+        variant.csPath = SHADER_GLSL_DIR + "HiZBuild.comp";
+        if (copyDepth)
+        {
+            variant.defines.insert("HIZ_COPY_DEPTH");
+        }
+        return variant;
+    }
+
+    void collectMaterialVariant(Material &material, std::vector<ShaderVariant> &variants)
+    {
+        material.shaderDefines = generateShaderDefines(material);
+
+        ShadingModel shadingModel = getShadingModel(material);
+        ShaderVariant variant;
+        if (!getShaderSources(shadingModel, variant))
+        {
+            return;
+        }
+        variant.defines = getShaderDefines(material, shadingModel);
+
+        // Auto mode may promote any variant at runtime, both programs are reachable
+        std::vector<ShaderVariant> materialVariants;
+        if (!supportsUberShader(shadingModel) || ShaderVariantMode::Uber != m_variantPolicy.getMode())
+        {
+            materialVariants.push_back(variant);
+        }
+        if (supportsUberShader(shadingModel) && ShaderVariantMode::Specialized != m_variantPolicy.getMode())
+        {
+            ShaderVariant uberVariant = variant;
+            uberVariant.defines = getUberShaderDefines(material, variant.defines);
+            materialVariants.push_back(uberVariant);
+        }
+
+        for (auto &materialVariant : materialVariants)
+        {
+            variants.push_back(materialVariant);
+            if (m_asyncShaderCompile)
+            {
+                variants.push_back(getFallbackVariant(materialVariant.defines));
+            }
+        }
+    }
+
+    void collectModelNodeVariants(ModelNode &node, std::vector<ShaderVariant> &variants)
+    {
+        for (auto &mesh : node.meshes)
+        {
+            collectMaterialVariant(*mesh.material, variants);
+        }
+
+        for (auto &child : node.children)
+        {
+            collectModelNodeVariants(child, variants);
+        }
+    }
+
+    ShadingModel getShadingModel(Material &material)
+    {
+        // opaque meshes only write the g-buffer in the deferred path
+        if (RenderPath::Deferred == m_renderPath && AlphaMode::Opaque == material.alphaMode)
+        {
+            return ShadingModel::GBuffer;
+        }
+
+        return material.shadingModel;
+    }
+
+    std::set<std::string> getShaderDefines(Material &material, ShadingModel shadingModel)
+    {
+        std::set<std::string> shaderDefines = material.shaderDefines;
+
+        // only the BlinnPhongWS shader handles clustered lights
+        if (RenderPath::ForwardClustered == m_renderPath
+            && (ShadingModel::BlinnPhong == shadingModel || ShadingModel::PBR == shadingModel))
+        {
+            shaderDefines.insert(CLUSTERED_LIGHTING_DEFINE);
+        }
+
+        if (m_gpuDriven && isGPUDrivenMaterial(material))
+        {
+            shaderDefines.insert(GPU_DRIVEN_DEFINE);
+        }
+
+        if (VertexFormat::Float32 != m_vertexFormat)
+        {
+            shaderDefines.insert(PACKED_VERTEX_DEFINE);
+        }
+
+        return shaderDefines;
+    }
+
+    // only BlinnPhongWS has the uber shader build
+    bool supportsUberShader(ShadingModel shadingModel)
+    {
+        return ShadingModel::BlinnPhong == shadingModel || ShadingModel::PBR == shadingModel;
+    }
+
+    bool useUberShader(ShadingModel shadingModel, size_t variantKey)
+    {
+        return supportsUberShader(shadingModel) && m_variantPolicy.useUberShader(variantKey);
+    }
+
+    // the material texture defines are replaced by u_textureFlags
+    std::set<std::string> getUberShaderDefines(Material &material, const std::set<std::string> &shaderDefines)
+    {
+        std::set<std::string> uberDefines;
+        for (auto &define : shaderDefines)
+        {
+            if (material.shaderDefines.count(define) == 0)
+            {
+                uberDefines.insert(define);
+            }
+        }
+        uberDefines.insert(UBER_SHADER_DEFINE);
+        return uberDefines;
+    }
+
+    // BlinnPhongWS and GBuffer vertex shaders read transforms from the instance buffer
+    bool isGPUDrivenMaterial(Material &material)
+    {
+        return AlphaMode::Opaque == material.alphaMode
+               && (ShadingModel::BlinnPhong == material.shadingModel || ShadingModel::PBR == material.shadingModel);
+    }
+
+    bool isIndirectDrawMesh(ModelMesh &mesh)
+    {
+        return m_gpuDriven && isGPUDrivenMaterial(*mesh.material);
+    }
+
     size_t getShaderProgramCacheKey(ShadingModel shadingModel, const std::set<std::string> &shaderDefines)
     {
         size_t seed = 0;
@@ -474,32 +1459,74 @@ private:
         m_uniformBlockScene->setData(&uniformScene, sizeof(UniformsScene));
     }
 
-    void updateUniformModel(const glm::mat4 &model, const glm::mat4 &view)
+    // decode maps quantized positions to mesh space, normals only see the model matrix
+    void updateUniformModel(const glm::mat4 &model, const glm::mat4 &view, const glm::mat4 &decode = glm::mat4(1.0f))
     {
         static UniformsModel uniformModel{};
 
-        uniformModel.u_modelMatrix = model;
-        uniformModel.u_modelViewProjectionMatrix = m_cameraCurrent->getPerspectiveMatrix() * view * model;
-        uniformModel.u_inverseTransposeModelMatrix = glm::mat3(glm::transpose(glm::inverse(model)));
+        glm::mat4 positionModel = model * decode;
+        uniformModel.u_modelMatrix = positionModel;
+        uniformModel.u_modelViewProjectionMatrix = m_cameraCurrent->getPerspectiveMatrix() * view * positionModel;
+        uniformModel.u_inverseTransposeModelMatrix = glm::mat3x4(glm::transpose(glm::inverse(model)));
 
         if (m_cameraDepth != nullptr)
         {
-            const glm::mat4 biasMatrix = {0.5f, 0.0f, 0.0f, 0.0f,
-                                          0.0f, 0.5f, 0.0f, 0.0f,
-                                          0.0f, 0.0f, 1.0f, 0.0f,
-                                          0.5f, 0.5f, 0.0f, 1.0f};
-            uniformModel.u_shadowMVPMatrix = biasMatrix * m_cameraDepth->getPerspectiveMatrix() * m_cameraDepth->getViewMatrix() * model;
+            uniformModel.u_shadowMVPMatrix = getShadowVPMatrix() * positionModel;
         }
 
         m_uniformBlockModel->setData(&uniformModel, sizeof(UniformsModel));
     }
 
+    void updateUniformLights()
+    {
+        static UniformsLights uniformLights{};
+
+        uniformLights.u_viewMatrix = m_cameraMain->getViewMatrix();
+        uniformLights.u_projectionMatrix = m_cameraMain->getPerspectiveMatrix();
+        uniformLights.u_inverseProjectionMatrix = glm::inverse(uniformLights.u_projectionMatrix);
+        uniformLights.u_shadowVPMatrix = getShadowVPMatrix();
+        uniformLights.u_screenSize = glm::ivec2(SCREEN_WIDTH, SCREEN_HEIGHT);
+        uniformLights.u_pointLightCount = (int)m_scene.pointLights.size();
+
+        if (m_lightClustering != nullptr)
+        {
+            uniformLights.u_clusterGridSize = m_lightClustering->getGridSize();
+            uniformLights.u_clusterDepthParams = m_lightClustering->getDepthParams();
+        }
+
+        m_uniformBlockLights->setData(&uniformLights, sizeof(UniformsLights));
+    }
+
+    void updateClusteredLights()
+    {
+        m_lightClustering->setProjection(m_cameraMain->getPerspectiveMatrix(), m_cameraMain->near(), m_cameraMain->far());
+        m_lightClustering->assignLights(m_scene.pointLights, m_cameraMain->getViewMatrix());
+
+        auto &grid = m_lightClustering->getLightGrid();
+        auto &indices = m_lightClustering->getLightIndices();
+        m_storageBlockClusterGrid->setData(grid.data(), (int)(grid.size() * sizeof(glm::uvec2)));
+        m_storageBlockClusterIndices->setData(indices.data(), (int)(indices.size() * sizeof(uint32_t)));
+        m_storageBlockPointLights->setData(m_scene.pointLights.data(), (int)(m_scene.pointLights.size() * sizeof(PointLight)));
+
+        updateUniformLights();
+    }
+
+    glm::mat4 getShadowVPMatrix()
+    {
+        const glm::mat4 biasMatrix = {0.5f, 0.0f, 0.0f, 0.0f,
+                                      0.0f, 0.5f, 0.0f, 0.0f,
+                                      0.0f, 0.0f, 1.0f, 0.0f,
+                                      0.5f, 0.5f, 0.0f, 1.0f};
+        return biasMatrix * m_cameraDepth->getPerspectiveMatrix() * m_cameraDepth->getViewMatrix();
+    }
+
     void updateUniformMaterial(Material &material, float specular)
     {
         static UniformsMaterial uniformMaterial{};
 
         uniformMaterial.u_baseColor = material.baseColor;
         uniformMaterial.u_kSpecular = specular;
+        uniformMaterial.u_textureFlags = material.textureFlags;
 
         m_uniformBlockMaterial->setData(&uniformMaterial, sizeof(UniformsMaterial));
     }
@@ -561,8 +1588,9 @@ private:
 
     std::set<std::string> generateShaderDefines(Material &material)
     {
+        // from the texture data so variants are known before any upload
         std::set<std::string> shaderDefines;
-        for(auto &kv : material.textures)
+        for(auto &kv : material.textureData)
         {
             const char * samplerDefine = material.samplerDefine((MaterialTexType)kv.first);
             if (samplerDefine != nullptr)
@@ -574,6 +1602,76 @@ private:
         return shaderDefines;
     }
 
+    // pending textures are left out, the uber shader falls back to the material constants
+    uint32_t generateTextureFlags(Material &material)
+    {
+        uint32_t flags = 0;
+        for (auto &kv : material.textureData)
+        {
+            auto it = material.textures.find(kv.first);
+            if (it == material.textures.end() || m_textureUploader.isPending(it->second.get()))
+            {
+                continue;
+            }
+            if (kv.first > 0 && kv.first < 32)
+            {
+                flags |= 1u << kv.first;
+            }
+        }
+
+        return flags;
+    }
+
+    // samplers point at placeholders until the uploader reports the texture resident
+    void updateResidentTextures(Material &material)
+    {
+        auto &resources = material.materialObj->shaderResources;
+        if (material.texturesResident || nullptr == resources)
+        {
+            return;
+        }
+
+        bool resident = true;
+        for (auto &kv : material.textures)
+        {
+            bool pending = m_textureUploader.isPending(kv.second.get());
+            resident = resident && !pending;
+
+            auto sampler = resources->samplers.find(kv.first);
+            if (sampler != resources->samplers.end())
+            {
+                sampler->second->setTexture(pending ? getPlaceholderTexture((MaterialTexType) kv.first) : kv.second);
+            }
+        }
+
+        material.textureFlags = generateTextureFlags(material);
+        material.texturesResident = resident;
+    }
+
+    std::shared_ptr<Texture> &getPlaceholderTexture(MaterialTexType type)
+    {
+        auto &texture = m_texturePlaceholders[(int)type];
+        if (nullptr == texture)
+        {
+            // neutral values: flat normal, no emission, full albedo and occlusion
+            RGBA color(255, 255, 255, 255);
+            if (MaterialTexType::NORMAL == type)
+            {
+                color = RGBA(128, 128, 255, 255);
+            }
+            else if (MaterialTexType::EMISSIVE == type)
+            {
+                color = RGBA(0, 0, 0, 255);
+            }
+
+            auto buffer = Buffer<RGBA>::makeDefault(1, 1);
+            *buffer->get(0, 0) = color;
+            texture = createTexture2DDefault(1, 1, TextureFormat::RGBA8, (int)TextureUsage::Sampler | (int)TextureUsage::UploadData, false);
+            texture->setImageData({buffer});
+        }
+        return texture;
+    }
+
     void updateShadowTextures(MaterialObject *materialObj, bool shadowPass)
     {
         if (nullptr == materialObj->shaderResources)
@@ -668,6 +1766,11 @@ private:
         return std::make_shared<UniformBlock>(name, size);
     }
 
+    std::shared_ptr<ShaderStorageBlock> createShaderStorageBlock(const std::string &name, int size)
+    {
+        return std::make_shared<ShaderStorageBlock>(name, size);
+    }
+
     std::shared_ptr<Framebuffer> createFramebuffer(bool offscreen)
     {
         return std::make_shared<Framebuffer>(offscreen);
@@ -704,6 +1807,7 @@ private:
 
 private:
     DemoScene m_scene;
+    RenderPath m_renderPath = RenderPath::Forward;
 
     std::shared_ptr<Camera> m_cameraMain = nullptr;
     std::shared_ptr<Camera> m_cameraDepth = nullptr;
@@ -711,19 +1815,74 @@ private:
 
     ShaderProgram *m_shaderProgram = nullptr;
 
+    ShaderCompileQueue m_shaderCompileQueue;
+    ShaderVariantPolicy m_variantPolicy;
+    TextureUploader m_textureUploader;
+    bool m_asyncTextureUpload = true;
+    TextureStreamer m_textureStreamer;
+    bool m_textureStreaming = true;
+    bool m_srgbTextures = false;
+    VertexFormat m_vertexFormat = VertexFormat::Float32;
+    std::unordered_map<const ModelBase *, MeshTexelDensity> m_meshTexelDensity;
+    std::unordered_map<int, std::shared_ptr<Texture>> m_texturePlaceholders;
+    bool m_asyncShaderCompile = true;
+
     // caches
     std::unordered_map<size_t, std::shared_ptr<ShaderProgram>> m_programCache;
+    std::unordered_map<size_t, std::shared_ptr<ShaderProgram>> m_fallbackProgramCache;
     std::unordered_map<size_t, std::shared_ptr<PipelineStates>> m_pipelineCache;
+    std::unordered_map<size_t, std::weak_ptr<Texture>> m_textureCache; // kept alive by the materials using them
 
     // uniform blocks
     std::shared_ptr<UniformBlock> m_uniformBlockScene;
     std::shared_ptr<UniformBlock> m_uniformBlockModel;
     std::shared_ptr<UniformBlock> m_uniformBlockMaterial;
+    std::shared_ptr<UniformBlock> m_uniformBlockLights;
+    std::shared_ptr<UniformBlock> m_uniformBlockCulling;
+
+    // storage blocks
+    std::shared_ptr<ShaderStorageBlock> m_storageBlockPointLights = nullptr;
+    std::shared_ptr<ShaderStorageBlock> m_storageBlockClusterGrid = nullptr;
+    std::shared_ptr<ShaderStorageBlock> m_storageBlockClusterIndices = nullptr;
 
     // shadow map
     std::shared_ptr<Framebuffer> m_fboShadow = nullptr;
     std::shared_ptr<Texture> m_texDepthShadow = nullptr;
     std::shared_ptr<Texture> m_shadowPlaceholder = nullptr;
+
+    // deferred
+    std::shared_ptr<Framebuffer> m_fboGBuffer = nullptr;
+    std::shared_ptr<Texture> m_texGBufferAlbedo = nullptr;
+    std::shared_ptr<Texture> m_texGBufferNormal = nullptr;
+    std::shared_ptr<Texture> m_texGBufferPosition = nullptr;
+    std::shared_ptr<Texture> m_texGBufferEmissive = nullptr;
+    std::shared_ptr<Texture> m_texGBufferDepth = nullptr;
+    std::shared_ptr<Framebuffer> m_fboDeferred = nullptr;
+    std::shared_ptr<Texture> m_texDeferredOutput = nullptr;
+    std::shared_ptr<ShaderProgram> m_programTiledDeferred = nullptr;
+    std::shared_ptr<ShaderResources> m_resourcesTiledDeferred = nullptr;
+
+    // clustered forward
+    std::shared_ptr<LightClustering> m_lightClustering = nullptr;
+
+    // gpu driven
+    bool m_gpuDriven = false;
+    std::shared_ptr<GPUDrivenScene> m_gpuDrivenScene = nullptr;
+    std::shared_ptr<ShaderProgram> m_programCulling = nullptr;
+    std::shared_ptr<ShaderResources> m_resourcesCulling = nullptr;
+    std::shared_ptr<Framebuffer> m_fboMain = nullptr;
+    std::shared_ptr<Texture> m_texMainColor = nullptr;
+    std::shared_ptr<Texture> m_texMainDepth = nullptr;
+
+    // hi-z
+    std::shared_ptr<Texture> m_texHiZ = nullptr;
+    std::shared_ptr<ShaderProgram> m_programHiZCopy = nullptr;
+    std::shared_ptr<ShaderProgram> m_programHiZReduce = nullptr;
+    std::shared_ptr<ShaderResources> m_resourcesHiZCopy = nullptr;
+    std::shared_ptr<ShaderResources> m_resourcesHiZReduce = nullptr;
+    glm::mat4 m_hizViewProjection{1.0f};
+    int m_hizMipCount = 1;
+    bool m_hizValid = false;
 };
 
 END_NAMESPACE(GLBase)
@@ -0,0 +1,79 @@
+#ifndef _SAMPLER_CACHE_HPP_
+#define _SAMPLER_CACHE_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+#include "Common/GLMInc.hpp"
+
+#include "Common/HashUtils.hpp"
+#include "Render/EnumsOpenGL.hpp"
+#include "Render/Texture.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Sampler objects shared by every texture with the same SamplerDesc, bound per texture
+// unit with glBindSampler so texture objects carry no sampling state.
+class SamplerCache
+{
+public:
+    static GLuint get(const SamplerDesc &desc)
+    {
+        size_t key = makeKey(desc);
+        auto it = s_samplers.find(key);
+        if (it != s_samplers.end())
+        {
+            return it->second;
+        }
+
+        GLuint samplerId = 0;
+        glGenSamplers(1, &samplerId);
+        glSamplerParameteri(samplerId, GL_TEXTURE_MIN_FILTER, cvtFilter(desc.filterMin));
+        glSamplerParameteri(samplerId, GL_TEXTURE_MAG_FILTER, cvtMagFilter(desc.filterMag));
+        glSamplerParameteri(samplerId, GL_TEXTURE_WRAP_S, cvtWrap(desc.wrapS));
+        glSamplerParameteri(samplerId, GL_TEXTURE_WRAP_T, cvtWrap(desc.wrapT));
+        glSamplerParameteri(samplerId, GL_TEXTURE_WRAP_R, cvtWrap(desc.wrapR));
+        glm::vec4 borderColor = cvtBorderColor(desc.borderColor);
+        glSamplerParameterfv(samplerId, GL_TEXTURE_BORDER_COLOR, &borderColor[0]);
+
+        s_samplers[key] = samplerId;
+        return samplerId;
+    }
+
+    static size_t count()
+    {
+        return s_samplers.size();
+    }
+
+    // the samplers belong to the current context
+    static void destroy()
+    {
+        for (auto &kv : s_samplers)
+        {
+            glDeleteSamplers(1, &kv.second);
+        }
+        s_samplers.clear();
+    }
+
+private:
+    static size_t makeKey(const SamplerDesc &desc)
+    {
+        size_t key = 0;
+        HashUtils::hashCombine(key, (int) desc.filterMin);
+        HashUtils::hashCombine(key, (int) desc.filterMag);
+        HashUtils::hashCombine(key, (int) desc.wrapS);
+        HashUtils::hashCombine(key, (int) desc.wrapT);
+        HashUtils::hashCombine(key, (int) desc.wrapR);
+        HashUtils::hashCombine(key, (int) desc.borderColor);
+        return key;
+    }
+
+private:
+    static std::unordered_map<size_t, GLuint> s_samplers;
+};
+
+std::unordered_map<size_t, GLuint> SamplerCache::s_samplers;
+
+END_NAMESPACE(GLBase)
+
+#endif // _SAMPLER_CACHE_HPP_
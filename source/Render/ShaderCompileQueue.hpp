@@ -0,0 +1,82 @@
+#ifndef _SHADER_COMPILE_QUEUE_HPP_
+#define _SHADER_COMPILE_QUEUE_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+
+#include "Common/Logger.hpp"
+#include "Common/OpenGLExtensions.hpp"
+#include "Render/ShaderProgram.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// Programs submitted here compile in the background with KHR_parallel_shader_compile,
+// poll() finishes the ones the driver reports complete without blocking. Without the
+// extension the submission still batches all variants before the first status query.
+class ShaderCompileQueue
+{
+public:
+    // 0xFFFFFFFF lets the driver pick the thread count
+    static void setMaxCompilerThreads(GLuint count)
+    {
+        if (OpenGLExtensions::hasParallelShaderCompile())
+        {
+            glMaxShaderCompilerThreadsKHR(count);
+        }
+    }
+
+    bool submit(const std::shared_ptr<ShaderProgram> &program, const std::string &vsPath, const std::string &fsPath)
+    {
+        if (!program->compileAndLinkFileAsync(vsPath, fsPath))
+        {
+            LOGE("ShaderCompileQueue::submit failed: %s", vsPath.c_str());
+            return false;
+        }
+
+        if (program->isCompiling())
+        {
+            m_pending.push_back({program, vsPath});
+        }
+        return true;
+    }
+
+    // wait forces the remaining programs to finish, blocking on the driver
+    void poll(bool wait = false)
+    {
+        auto it = m_pending.begin();
+        while (it != m_pending.end())
+        {
+            auto &program = it->program;
+            if (!wait && !program->isCompileCompleted())
+            {
+                ++it;
+                continue;
+            }
+
+            if (!program->finishCompile())
+            {
+                LOGE("ShaderCompileQueue: compile program failed: %s", it->name.c_str());
+            }
+            it = m_pending.erase(it);
+        }
+    }
+
+    inline size_t pendingCount() const
+    {
+        return m_pending.size();
+    }
+
+private:
+    struct PendingProgram
+    {
+        std::shared_ptr<ShaderProgram> program;
+        std::string name;
+    };
+
+    std::vector<PendingProgram> m_pending;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _SHADER_COMPILE_QUEUE_HPP_
@@ -5,13 +5,37 @@
 
 #include <glad/glad.h>
 
-#include "Common/FileUtils.hpp"
+#include "Render/GLSLPreprocessor.hpp"
 #include "Render/ProgramGLSL.hpp"
 #include "Render/ShaderResources.hpp"
 #include "Render/UniformBase.hpp"
 
 BEGIN_NAMESPACE(GLBase)
 
+// sources and defines of one program, compute programs only set csPath
+struct ShaderVariant
+{
+    std::string vsPath;
+    std::string fsPath;
+    std::string csPath;
+    std::set<std::string> defines;
+
+    inline bool isCompute() const
+    {
+        return !csPath.empty();
+    }
+
+    std::string name() const
+    {
+        std::string str = isCompute() ? csPath : (vsPath + " " + fsPath);
+        for (auto &def : defines)
+        {
+            str += " -D" + def;
+        }
+        return str;
+    }
+};
+
 class ShaderProgram
 {
 public:
@@ -37,18 +61,23 @@ public:
     {
         for (auto &kv : resources.blocks)
         {
-            bindUniform(*kv.second, false);
+            bindUniform(*kv.second, m_uniformBlockBinding);
         }
 
         for (auto &kv : resources.samplers)
         {
-            bindUniform(*kv.second, true);
+            bindUniform(*kv.second, m_uniformSamplerBinding);
+        }
+
+        for (auto &kv : resources.storageBlocks)
+        {
+            bindUniform(*kv.second, m_storageBlockBinding);
         }
     }
 
     bool compileAndLinkFile(const std::string &vsPath, const std::string &fsPath)
     {
-        return compileAndLink(FileUtils::readText(vsPath), FileUtils::readText(fsPath));
+        return compileAndLink(GLSLPreprocessor::readFile(vsPath), GLSLPreprocessor::readFile(fsPath));
     }
 
     bool compileAndLink(const std::string &vsSource, const std::string &fsSource)
@@ -59,15 +88,81 @@ public:
         return ret;
     }
 
+    bool compileAndLinkVariant(const ShaderVariant &variant)
+    {
+        addDefines(variant.defines);
+        if (variant.isCompute())
+        {
+            return compileAndLinkComputeFile(variant.csPath);
+        }
+        return compileAndLinkFile(variant.vsPath, variant.fsPath);
+    }
+
+    bool compileAndLinkFileAsync(const std::string &vsPath, const std::string &fsPath)
+    {
+        return compileAndLinkAsync(GLSLPreprocessor::readFile(vsPath), GLSLPreprocessor::readFile(fsPath));
+    }
+
+    bool compileAndLinkAsync(const std::string &vsSource, const std::string &fsSource)
+    {
+        bool ret = m_programGLSL.loadSourceAsync(vsSource, fsSource);
+        m_programId = m_programGLSL.getId();
+
+        return ret;
+    }
+
+    inline bool isCompiling() const
+    {
+        return m_programGLSL.isCompiling();
+    }
+
+    inline bool isCompileCompleted() const
+    {
+        return m_programGLSL.isCompleted();
+    }
+
+    bool finishCompile()
+    {
+        bool ret = m_programGLSL.finishAsync();
+        m_programId = m_programGLSL.getId();
+
+        return ret;
+    }
+
+    inline uint64_t getBinaryKey() const
+    {
+        return m_programGLSL.getBinaryKey();
+    }
+
+    // linked and not waiting on the driver
+    inline bool isReady() const
+    {
+        return !isCompiling() && m_programId != 0;
+    }
+
+    bool compileAndLinkComputeFile(const std::string &csPath)
+    {
+        return compileAndLinkCompute(GLSLPreprocessor::readFile(csPath));
+    }
+
+    bool compileAndLinkCompute(const std::string &csSource)
+    {
+        bool ret = m_programGLSL.loadComputeSource(csSource);
+        m_programId = m_programGLSL.getId();
+
+        return ret;
+    }
+
     void use()
     {
         m_programGLSL.use();
         m_uniformBlockBinding = 0;
         m_uniformSamplerBinding = 0;
+        m_storageBlockBinding = 0;
     }
 
 private:
-    bool bindUniform(UniformBase &uniform, bool isSampler)
+    bool bindUniform(UniformBase &uniform, int &binding)
     {
         int hash = uniform.getHash();
         int location = -1;
@@ -84,28 +179,18 @@ private:
         if (location < 0)
             return false;
 
-        int binding = isSampler ? getUniformSamplerBinding() : getUniformBlockBinding();
-        uniform.bindProgram(m_programId, binding, location);
+        uniform.bindProgram(m_programId, binding++, location);
 
         return true;
     }
 
-    int getUniformBlockBinding()
-    {
-        return m_uniformBlockBinding++;
-    }
-
-    int getUniformSamplerBinding()
-    {
-        return m_uniformSamplerBinding++;
-    }
-
 private:
     GLuint m_programId = 0;
     ProgramGLSL m_programGLSL;
 
     int m_uniformBlockBinding = 0;
     int m_uniformSamplerBinding = 0;
+    int m_storageBlockBinding = 0;
 
     std::unordered_map<int, int> m_uniformLocations;
 };
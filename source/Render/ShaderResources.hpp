@@ -3,6 +3,7 @@
 
 #include "Common/cpplang.hpp"
 
+#include "Render/ShaderStorageBlock.hpp"
 #include "Render/UniformBlock.hpp"
 #include "Render/UniformSampler.hpp"
 
@@ -13,6 +14,7 @@ class ShaderResources
 public:
     std::unordered_map<int, std::shared_ptr<UniformBlock>> blocks;
     std::unordered_map<int, std::shared_ptr<UniformSampler>> samplers;
+    std::unordered_map<int, std::shared_ptr<ShaderStorageBlock>> storageBlocks;
 };
 
 END_NAMESPACE(GLBase)
@@ -0,0 +1,75 @@
+#ifndef _SHADER_STORAGE_BLOCK_HPP_
+#define _SHADER_STORAGE_BLOCK_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+
+#include "Common/OpenGLExtensions.hpp"
+#include "Render/UniformBase.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+class ShaderStorageBlock : public UniformBase
+{
+public:
+    ShaderStorageBlock(const std::string &name, int size) : UniformBase(name), m_blockSize(size)
+    {
+        glGenBuffers(1, &m_ssbo);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ssbo);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    ~ShaderStorageBlock()
+    {
+        glDeleteBuffers(1, &m_ssbo);
+    }
+
+public:
+    int getLocation(int programId) override
+    {
+        return (int)glGetProgramResourceIndex(programId, GL_SHADER_STORAGE_BLOCK, name.c_str());
+    }
+
+    void bindProgram(int programId, int binding, int location) override
+    {
+        if (location < 0)
+            return;
+
+        glShaderStorageBlockBinding(programId, location, binding);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, binding, m_ssbo);
+    }
+
+    void setData(const void *data, int len)
+    {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, m_ssbo);
+        if (len > m_blockSize)
+        {
+            // grow only, the storage is reused by later smaller uploads
+            glBufferData(GL_SHADER_STORAGE_BUFFER, len, data, GL_DYNAMIC_DRAW);
+            m_blockSize = len;
+        }
+        else if (len > 0)
+        {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, len, data);
+        }
+    }
+
+    inline GLuint getId() const
+    {
+        return m_ssbo;
+    }
+
+    inline int getSize() const
+    {
+        return m_blockSize;
+    }
+
+private:
+    GLuint m_ssbo = 0;
+    int m_blockSize;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _SHADER_STORAGE_BLOCK_HPP_
@@ -0,0 +1,124 @@
+#ifndef _SHADER_VARIANT_POLICY_HPP_
+#define _SHADER_VARIANT_POLICY_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/Logger.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+enum class ShaderVariantMode
+{
+    Specialized = 0,    // one program per texture define combination
+    Uber,               // texture presence from UniformsMaterial::u_textureFlags
+    Auto,               // uber shader, the most drawn variants get specialized
+};
+
+// Decides per specialized variant (the program cache key without UBER_SHADER) whether
+// materials draw with it or with the shared uber shader. In Auto mode the draws of each
+// variant are counted over an evaluation window, the variants with the most draws per
+// frame are promoted up to the budget, promotion is kept so programs are never evicted.
+class ShaderVariantPolicy
+{
+public:
+    void setMode(ShaderVariantMode mode)
+    {
+        m_mode = mode;
+    }
+
+    ShaderVariantMode getMode() const
+    {
+        return m_mode;
+    }
+
+    // upper bound of specialized programs in Auto mode
+    void setMaxSpecialized(size_t count)
+    {
+        m_maxSpecialized = count;
+    }
+
+    bool useUberShader(size_t variantKey) const
+    {
+        switch (m_mode)
+        {
+            case ShaderVariantMode::Specialized:
+                return false;
+            case ShaderVariantMode::Uber:
+                return true;
+            default:
+                break;
+        }
+
+        return m_specialized.count(variantKey) == 0;
+    }
+
+    bool isSpecialized(size_t variantKey) const
+    {
+        return m_specialized.count(variantKey) > 0;
+    }
+
+    void recordDraw(size_t variantKey)
+    {
+        if (ShaderVariantMode::Auto == m_mode)
+        {
+            m_drawCounts[variantKey]++;
+        }
+    }
+
+    // returns true if variants were promoted
+    bool endFrame()
+    {
+        if (ShaderVariantMode::Auto != m_mode)
+        {
+            return false;
+        }
+
+        if (++m_frameCount < EVALUATE_FRAMES)
+        {
+            return false;
+        }
+
+        std::vector<std::pair<size_t, size_t>> candidates;
+        for (auto &kv : m_drawCounts)
+        {
+            if (m_specialized.count(kv.first) == 0 && kv.second >= MIN_DRAWS_PER_FRAME * m_frameCount)
+            {
+                candidates.push_back(kv);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end(), [](const std::pair<size_t, size_t> &a, const std::pair<size_t, size_t> &b) -> bool {
+            return a.second > b.second;
+        });
+
+        bool promoted = false;
+        for (auto &kv : candidates)
+        {
+            if (m_specialized.size() >= m_maxSpecialized)
+            {
+                break;
+            }
+            m_specialized.insert(kv.first);
+            promoted = true;
+            LOGD("shader variant specialized: %016zx, draws per frame: %zu", kv.first, kv.second / m_frameCount);
+        }
+
+        m_drawCounts.clear();
+        m_frameCount = 0;
+        return promoted;
+    }
+
+private:
+    static constexpr size_t EVALUATE_FRAMES = 60;
+    static constexpr size_t MIN_DRAWS_PER_FRAME = 4;
+
+    ShaderVariantMode m_mode = ShaderVariantMode::Specialized;
+    size_t m_maxSpecialized = 4;
+
+    size_t m_frameCount = 0;
+    std::unordered_map<size_t, size_t> m_drawCounts;
+    std::unordered_set<size_t> m_specialized;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _SHADER_VARIANT_POLICY_HPP_
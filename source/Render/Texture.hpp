@@ -6,6 +6,7 @@
 #include <glad/glad.h>
 
 #include "Common/Buffer.hpp"
+#include "Common/OpenGLExtensions.hpp"
 
 BEGIN_NAMESPACE(GLBase)
 
@@ -55,6 +56,19 @@ enum class TextureFormat
 {
     RGBA8 = 0,
     FLOAT32,
+    RGBA16F,
+    RGBA32F,
+    R32F,
+    R8,             // 8 bit unorm formats take RGBA8 client data, unused channels are dropped
+    RG8,
+    RGB8,
+    SRGB8_ALPHA8,
+    BC1,            // block compressed, uploaded with setCompressedImageData
+    BC3,
+    BC4,
+    BC5,
+    BC1_SRGB,
+    BC3_SRGB,
 };
 
 enum class TextureUsage
@@ -78,6 +92,15 @@ struct TextureDesc
     std::string tag;
 };
 
+// block compressed mip chain, level 0 first
+struct CompressedImage
+{
+    TextureFormat format = TextureFormat::BC1;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<uint8_t>> levels;
+};
+
 struct TextureOpenGLDesc
 {
     GLint internalformat;
@@ -97,25 +120,200 @@ public:
         switch(format)
         {
             case TextureFormat::RGBA8:
-                ret.internalformat = GL_RGBA;
+                ret.internalformat = GL_RGBA8;
                 ret.format = GL_RGBA;
                 ret.type = GL_UNSIGNED_BYTE;
                 break;
             case TextureFormat::FLOAT32:
-                ret.internalformat = GL_DEPTH_COMPONENT;
+                ret.internalformat = GL_DEPTH_COMPONENT32F;
                 ret.format = GL_DEPTH_COMPONENT;
                 ret.type = GL_FLOAT;
                 break;
+            case TextureFormat::RGBA16F:
+                ret.internalformat = GL_RGBA16F;
+                ret.format = GL_RGBA;
+                ret.type = GL_FLOAT;
+                break;
+            case TextureFormat::RGBA32F:
+                ret.internalformat = GL_RGBA32F;
+                ret.format = GL_RGBA;
+                ret.type = GL_FLOAT;
+                break;
+            case TextureFormat::R32F:
+                ret.internalformat = GL_R32F;
+                ret.format = GL_RED;
+                ret.type = GL_FLOAT;
+                break;
+            case TextureFormat::R8:
+                ret.internalformat = GL_R8;
+                ret.format = GL_RGBA;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::RG8:
+                ret.internalformat = GL_RG8;
+                ret.format = GL_RGBA;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::RGB8:
+                ret.internalformat = GL_RGB8;
+                ret.format = GL_RGBA;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::SRGB8_ALPHA8:
+                ret.internalformat = GL_SRGB8_ALPHA8;
+                ret.format = GL_RGBA;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::BC1:
+                ret.internalformat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+                ret.format = GL_RGBA;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::BC3:
+                ret.internalformat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+                ret.format = GL_RGBA;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::BC4:
+                ret.internalformat = GL_COMPRESSED_RED_RGTC1;
+                ret.format = GL_RED;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::BC5:
+                ret.internalformat = GL_COMPRESSED_RG_RGTC2;
+                ret.format = GL_RG;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::BC1_SRGB:
+                ret.internalformat = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+                ret.format = GL_RGBA;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
+            case TextureFormat::BC3_SRGB:
+                ret.internalformat = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+                ret.format = GL_RGBA;
+                ret.type = GL_UNSIGNED_BYTE;
+                break;
         }
 
         return ret;
     }
 
+    static bool isCompressedFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::BC1:
+            case TextureFormat::BC3:
+            case TextureFormat::BC4:
+            case TextureFormat::BC5:
+            case TextureFormat::BC1_SRGB:
+            case TextureFormat::BC3_SRGB:
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    // formats filled from Buffer<RGBA> images
+    static bool isUNorm8Format(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::RGBA8:
+            case TextureFormat::R8:
+            case TextureFormat::RG8:
+            case TextureFormat::RGB8:
+            case TextureFormat::SRGB8_ALPHA8:
+                return true;
+            default:
+                break;
+        }
+        return false;
+    }
+
+    // the same texel layout without srgb decoding
+    static TextureFormat getLinearFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::SRGB8_ALPHA8:
+                return TextureFormat::RGBA8;
+            case TextureFormat::BC1_SRGB:
+                return TextureFormat::BC1;
+            case TextureFormat::BC3_SRGB:
+                return TextureFormat::BC3;
+            default:
+                break;
+        }
+        return format;
+    }
+
+    static TextureFormat getSRGBFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::RGBA8:
+                return TextureFormat::SRGB8_ALPHA8;
+            case TextureFormat::BC1:
+                return TextureFormat::BC1_SRGB;
+            case TextureFormat::BC3:
+                return TextureFormat::BC3_SRGB;
+            default:
+                break;
+        }
+        return format;
+    }
+
+    // bytes per texel of uncompressed formats in video memory
+    static size_t getFormatSize(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::R8:
+                return 1;
+            case TextureFormat::RG8:
+                return 2;
+            case TextureFormat::RGB8:
+                return 3;
+            case TextureFormat::RGBA16F:
+                return 8;
+            case TextureFormat::RGBA32F:
+                return 16;
+            default:
+                break;
+        }
+        return 4;
+    }
+
+    static bool isFormatSupported(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::BC1:
+            case TextureFormat::BC3:
+                return OpenGLExtensions::hasTextureCompressionS3TC();
+            case TextureFormat::BC1_SRGB:
+            case TextureFormat::BC3_SRGB:
+                return OpenGLExtensions::hasTextureCompressionS3TCSRGB();
+            default:
+                break;
+        }
+        return true;
+    }
+
     inline int getId() const
     {
         return (int)m_texId;
     }
 
+    // shared sampler object from SamplerCache, 0 before setSamplerDesc
+    inline GLuint getSamplerId() const
+    {
+        return m_samplerId;
+    }
+
     inline uint32_t getLevelWidth(uint32_t level)
     {
         return std::max(1, width >> level);
@@ -126,13 +324,28 @@ public:
         return std::max(1, height >> level);
     }
 
+    inline uint32_t getLevelCount() const
+    {
+        return (uint32_t) std::floor(std::log2(std::max(width, height))) + 1;
+    }
+
     virtual void setSamplerDesc(SamplerDesc &sampler){};
     virtual void initImageData() {};
     virtual void setImageData(const std::vector<std::shared_ptr<Buffer<RGBA>>> &buffers){};
+    // rows [yOffset, yOffset + rows) of a level, data is an offset if a pixel unpack buffer is bound
+    virtual void setImageSubData(uint32_t level, int yOffset, int rows, const void *data){};
+    virtual void generateMipmaps(){};
+    // every level of the chain, the texture format must match the image format
+    virtual void setCompressedImageData(const CompressedImage &image){};
+    // storage of single levels for mip streaming, only levels in [base, max] are sampled
+    virtual void initLevelData(uint32_t level){};
+    virtual void releaseLevelData(uint32_t level){};
+    virtual void setLevelRange(uint32_t baseLevel, uint32_t maxLevel){};
     virtual void dumpImage(const char *path, uint32_t layer, uint32_t level) = 0;
 
 protected:
     GLuint m_texId = 0;
+    GLuint m_samplerId = 0;
     TextureOpenGLDesc m_glDesc{};
 };
 
@@ -7,6 +7,7 @@
 #include "Common/GLMInc.hpp"
 
 #include "Render/EnumsOpenGL.hpp"
+#include "Render/SamplerCache.hpp"
 #include "Render/Texture.hpp"
 
 BEGIN_NAMESPACE(GLBase)
@@ -42,22 +43,27 @@ public:
         if (multiSample)
             return;
 
-        glBindTexture(m_target, m_texId);
-        glTexParameteri(m_target, GL_TEXTURE_MIN_FILTER, cvtFilter(sampler.filterMin));
-        glTexParameteri(m_target, GL_TEXTURE_MAG_FILTER, cvtFilter(sampler.filterMag));
-        glTexParameteri(m_target, GL_TEXTURE_WRAP_S, cvtWrap(sampler.wrapS));
-        glTexParameteri(m_target, GL_TEXTURE_WRAP_T, cvtWrap(sampler.wrapT));
-        glm::vec4 borderColor = cvtBorderColor(sampler.borderColor);
-        glTexParameterfv(m_target, GL_TEXTURE_BORDER_COLOR, &borderColor[0]);
+        m_samplerId = SamplerCache::get(sampler);
     }
 
+    // immutable storage with the exact level count when available
     void initImageData() override
     {
+        if (m_immutable)
+        {
+            return;
+        }
+
         glBindTexture(m_target, m_texId);
         if (multiSample)
         {
             glTexImage2DMultisample(m_target, 4, m_glDesc.internalformat, width, height, GL_TRUE);
         }
+        else if (OpenGLExtensions::hasTextureStorage())
+        {
+            glTexStorage2D(m_target, (GLsizei) (useMipmaps ? getLevelCount() : 1), m_glDesc.internalformat, width, height);
+            m_immutable = true;
+        }
         else
         {
             glTexImage2D(m_target, 0, m_glDesc.internalformat, width, height, 0, m_glDesc.format, m_glDesc.type, nullptr);
@@ -77,7 +83,7 @@ public:
             return;
         }
 
-        if (format != TextureFormat::RGBA8)
+        if (!isUNorm8Format(format))
         {
             LOGE("setImageData error: format not match");
             return;
@@ -89,15 +95,124 @@ public:
             return;
         }
 
+        // a complete chain is uploaded level by level, otherwise the driver builds the mips
+        if (OpenGLExtensions::hasTextureStorage())
+        {
+            initImageData();
+        }
         glBindTexture(m_target, m_texId);
-        glTexImage2D(m_target, 0, m_glDesc.internalformat, width, height, 0, m_glDesc.format, m_glDesc.type, buffers[0]->getRawDataPtr());
+        for (uint32_t level = 0; level < buffers.size() && level < getLevelCount(); level++)
+        {
+            if (m_immutable)
+            {
+                glTexSubImage2D(m_target, (GLint) level, 0, 0, (GLsizei) getLevelWidth(level), (GLsizei) getLevelHeight(level),
+                                m_glDesc.format, m_glDesc.type, buffers[level]->getRawDataPtr());
+            }
+            else
+            {
+                glTexImage2D(m_target, (GLint) level, m_glDesc.internalformat, (GLsizei) getLevelWidth(level), (GLsizei) getLevelHeight(level), 0,
+                             m_glDesc.format, m_glDesc.type, buffers[level]->getRawDataPtr());
+            }
+        }
 
-        if (useMipmaps)
+        if (useMipmaps && buffers.size() < getLevelCount())
         {
             glGenerateMipmap(m_target);
         }
     }
 
+    void setImageSubData(uint32_t level, int yOffset, int rows, const void *data) override
+    {
+        if (multiSample)
+        {
+            LOGE("setImageSubData not support: multi sample texture");
+            return;
+        }
+
+        glBindTexture(m_target, m_texId);
+        glTexSubImage2D(m_target, (GLint) level, 0, yOffset, (GLsizei) getLevelWidth(level), rows, m_glDesc.format, m_glDesc.type, data);
+    }
+
+    void setCompressedImageData(const CompressedImage &image) override
+    {
+        if (multiSample || image.format != getLinearFormat(format) || image.levels.empty())
+        {
+            LOGE("setCompressedImageData error: format not match");
+            return;
+        }
+
+        if ((uint32_t) width != image.width || (uint32_t) height != image.height)
+        {
+            LOGE("setCompressedImageData error: size not match");
+            return;
+        }
+
+        glBindTexture(m_target, m_texId);
+        if (OpenGLExtensions::hasTextureStorage() && !m_immutable)
+        {
+            glTexStorage2D(m_target, (GLsizei) image.levels.size(), m_glDesc.internalformat, width, height);
+            m_immutable = true;
+        }
+        for (uint32_t level = 0; level < image.levels.size(); level++)
+        {
+            auto &data = image.levels[level];
+            if (m_immutable)
+            {
+                glCompressedTexSubImage2D(m_target, (GLint) level, 0, 0, (GLsizei) getLevelWidth(level), (GLsizei) getLevelHeight(level),
+                                          m_glDesc.internalformat, (GLsizei) data.size(), data.data());
+            }
+            else
+            {
+                glCompressedTexImage2D(m_target, (GLint) level, m_glDesc.internalformat, (GLsizei) getLevelWidth(level),
+                                       (GLsizei) getLevelHeight(level), 0, (GLsizei) data.size(), data.data());
+            }
+        }
+        if (!m_immutable)
+        {
+            glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, (GLint) image.levels.size() - 1);
+        }
+    }
+
+    void generateMipmaps() override
+    {
+        if (multiSample || !useMipmaps)
+            return;
+
+        glBindTexture(m_target, m_texId);
+        glGenerateMipmap(m_target);
+    }
+
+    // streamed textures keep mutable storage, immutable storage could not release levels
+    void initLevelData(uint32_t level) override
+    {
+        if (multiSample || m_immutable)
+            return;
+
+        glBindTexture(m_target, m_texId);
+        glTexImage2D(m_target, (GLint) level, m_glDesc.internalformat, (GLsizei) getLevelWidth(level), (GLsizei) getLevelHeight(level), 0,
+                     m_glDesc.format, m_glDesc.type, nullptr);
+    }
+
+    // a zero sized image frees the level
+    void releaseLevelData(uint32_t level) override
+    {
+        if (multiSample || m_immutable)
+            return;
+
+        glBindTexture(m_target, m_texId);
+        glTexImage2D(m_target, (GLint) level, m_glDesc.internalformat, 0, 0, 0, m_glDesc.format, m_glDesc.type, nullptr);
+    }
+
+    void setLevelRange(uint32_t baseLevel, uint32_t maxLevel) override
+    {
+        if (multiSample)
+            return;
+
+        glBindTexture(m_target, m_texId);
+        glTexParameteri(m_target, GL_TEXTURE_BASE_LEVEL, (GLint) baseLevel);
+        glTexParameteri(m_target, GL_TEXTURE_MAX_LEVEL, (GLint) maxLevel);
+    }
+
     void dumpImage(const char *path, uint32_t layer, uint32_t level) override
     {
         if (multiSample)
@@ -135,6 +250,7 @@ public:
 
 private:
     GLenum m_target = 0;
+    bool m_immutable = false;
 };
 
 END_NAMESPACE(GLBase)
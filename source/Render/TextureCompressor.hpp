@@ -0,0 +1,202 @@
+#ifndef _TEXTURE_COMPRESSOR_HPP_
+#define _TEXTURE_COMPRESSOR_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/BlockCompression.hpp"
+#include "Common/Buffer.hpp"
+#include "Common/DiskCache.hpp"
+#include "Common/FileUtils.hpp"
+#include "Common/HashUtils.hpp"
+#include "Common/Logger.hpp"
+#include "Config/Config.hpp"
+#include "Render/Material.hpp"
+#include "Render/Texture.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+// bump when the encoders, the mip filter or the cache file layout change
+const uint32_t TEXTURE_CACHE_VERSION = 3;
+
+// Encodes material textures to BCn mip chains. Albedo and emissive use BC1, or BC3 if
+// any texel is not opaque, normal maps BC5 and occlusion BC4. The chains are stored on
+// disk keyed by a hash of level 0 and the format, so only new content is encoded.
+// Thread safe, the loader runs one texture per worker.
+class TextureCompressor
+{
+public:
+    // RGBA8 if the texture type stays uncompressed
+    static TextureFormat selectFormat(MaterialTexType type, const Buffer<RGBA> &buffer)
+    {
+        switch (type)
+        {
+            case MaterialTexType::ALBEDO:
+            case MaterialTexType::EMISSIVE:
+                return isOpaque(buffer) ? TextureFormat::BC1 : TextureFormat::BC3;
+            case MaterialTexType::NORMAL:
+                return TextureFormat::BC5;
+            case MaterialTexType::AMBIENT_OCCLUSION:
+                return TextureFormat::BC4;
+            default:
+                break;
+        }
+        return TextureFormat::RGBA8;
+    }
+
+    // levels is the chain from level 0, srgb tells how the mips were filtered
+    static std::shared_ptr<CompressedImage> compress(const std::vector<std::shared_ptr<Buffer<RGBA>>> &levels, TextureFormat format, bool srgb)
+    {
+        uint64_t key = makeKey(levels, format, srgb);
+        auto image = load(key, format);
+        if (image != nullptr)
+        {
+            return image;
+        }
+
+        image = std::make_shared<CompressedImage>();
+        image->format = format;
+        image->width = (uint32_t) levels[0]->getWidth();
+        image->height = (uint32_t) levels[0]->getHeight();
+
+        BlockFormat blockFormat = getBlockFormat(format);
+        for (auto &level : levels)
+        {
+            std::vector<uint8_t> data(BlockCompression::levelSize(blockFormat, level->getWidth(), level->getHeight()));
+            BlockCompression::compressRows(*level, blockFormat, 0, (level->getHeight() + 3) / 4, data.data());
+            image->levels.push_back(std::move(data));
+        }
+
+        store(key, *image);
+        return image;
+    }
+
+private:
+    struct ImageHeader
+    {
+        uint32_t format;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+    };
+
+    static constexpr uint32_t CACHE_FILE_MAGIC = 0x54434247; // "GBCT"
+
+    static const DiskCache &diskCache()
+    {
+        static const DiskCache cache(TEXTURE_CACHE_DIR, "bct", CACHE_FILE_MAGIC, TEXTURE_CACHE_VERSION, "texture cache");
+        return cache;
+    }
+
+    static bool isOpaque(const Buffer<RGBA> &buffer)
+    {
+        const RGBA *pixels = buffer.getRawDataPtr();
+        size_t count = buffer.getWidth() * buffer.getHeight();
+        for (size_t i = 0; i < count; i++)
+        {
+            if (pixels[i].a != 255)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static BlockFormat getBlockFormat(TextureFormat format)
+    {
+        switch (format)
+        {
+            case TextureFormat::BC3:
+                return BlockFormat::BC3;
+            case TextureFormat::BC4:
+                return BlockFormat::BC4;
+            case TextureFormat::BC5:
+                return BlockFormat::BC5;
+            default:
+                break;
+        }
+        return BlockFormat::BC1;
+    }
+
+    // the mips follow from level 0 and the filter, which the version and srgb flag stand for
+    static uint64_t makeKey(const std::vector<std::shared_ptr<Buffer<RGBA>>> &levels, TextureFormat format, bool srgb)
+    {
+        auto &level0 = *levels[0];
+        uint32_t params[6] = {TEXTURE_CACHE_VERSION, (uint32_t) format, srgb ? 1u : 0u, (uint32_t) levels.size(),
+                              (uint32_t) level0.getWidth(), (uint32_t) level0.getHeight()};
+        uint64_t key = HashUtils::hashBytes(params, sizeof(params));
+        return HashUtils::hashContent(level0.getRawDataPtr(), level0.getWidth() * level0.getHeight() * sizeof(RGBA), key);
+    }
+
+    static std::shared_ptr<CompressedImage> load(uint64_t key, TextureFormat format)
+    {
+        auto &cache = diskCache();
+        std::string path = cache.getPath(key);
+        if (!FileUtils::exists(path))
+        {
+            return nullptr;
+        }
+
+        std::vector<uint8_t> data = FileUtils::readBytes(path);
+        if (!cache.checkHeader(data.data(), data.size(), key))
+        {
+            return nullptr;
+        }
+
+        ImageHeader header{};
+        size_t offset = DiskCache::HEADER_SIZE + sizeof(ImageHeader);
+        if (data.size() >= offset)
+        {
+            memcpy(&header, data.data() + DiskCache::HEADER_SIZE, sizeof(ImageHeader));
+        }
+        if (data.size() < offset || header.format != (uint32_t) format)
+        {
+            LOGW("texture cache mismatch: %s", path.c_str());
+            return nullptr;
+        }
+
+        auto image = std::make_shared<CompressedImage>();
+        image->format = format;
+        image->width = header.width;
+        image->height = header.height;
+
+        BlockFormat blockFormat = getBlockFormat(format);
+        for (uint32_t level = 0; level < header.levelCount; level++)
+        {
+            size_t levelSize = BlockCompression::levelSize(blockFormat, std::max(1u, header.width >> level),
+                                                           std::max(1u, header.height >> level));
+            if (offset + levelSize > data.size())
+            {
+                LOGW("texture cache truncated: %s", path.c_str());
+                return nullptr;
+            }
+            image->levels.emplace_back(data.begin() + offset, data.begin() + offset + levelSize);
+            offset += levelSize;
+        }
+
+        LOGD("texture cache hit: %s", path.c_str());
+        return image;
+    }
+
+    static bool store(uint64_t key, const CompressedImage &image)
+    {
+        ImageHeader header{};
+        header.format = (uint32_t) image.format;
+        header.width = image.width;
+        header.height = image.height;
+        header.levelCount = (uint32_t) image.levels.size();
+
+        std::vector<uint8_t> data;
+        diskCache().writeHeader(data, key);
+        data.insert(data.end(), (const uint8_t *) &header, (const uint8_t *) &header + sizeof(ImageHeader));
+        for (auto &level : image.levels)
+        {
+            data.insert(data.end(), level.begin(), level.end());
+        }
+
+        return diskCache().write(key, data);
+    }
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _TEXTURE_COMPRESSOR_HPP_
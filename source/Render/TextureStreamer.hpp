@@ -0,0 +1,326 @@
+#ifndef _TEXTURE_STREAMER_HPP_
+#define _TEXTURE_STREAMER_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include "Common/Buffer.hpp"
+#include "Common/GLMInc.hpp"
+#include "Common/Logger.hpp"
+#include "Model/ModelBase.hpp"
+#include "Render/Texture.hpp"
+#include "Render/TextureUploader.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+const size_t TEXTURE_STREAMING_BUDGET = 512 * 1024 * 1024;
+const size_t TEXTURE_STREAMING_FRAME_UPLOAD = 16 * 1024 * 1024;
+const uint32_t TEXTURE_STREAMING_TAIL_SIZE = 64;     // levels up to this size are always resident
+const uint32_t TEXTURE_STREAMING_UNUSED_FRAMES = 60; // unused textures are evicted first
+
+// texels per world unit of a mesh, measured in model space
+struct MeshTexelDensity
+{
+    glm::vec3 center{0.0f};
+    float radius = 0.0f;
+    float uvDensity = 0.0f; // sqrt(uv area / surface area)
+};
+
+// Keeps the low mips of every registered texture resident and streams the finer ones
+// in as meshes request them. Requests come from the screen space texel density of the
+// visible meshes, one level per texture is uploaded at a time from coarse to fine. The
+// resident bytes stay below the budget by dropping top mips of textures that have more
+// detail than requested or were not requested for a while. Textures are held weakly, an
+// entry and its cpu chain go away with the last material using the texture.
+class TextureStreamer
+{
+public:
+    void setBudget(size_t bytes)
+    {
+        m_budget = bytes;
+    }
+
+    inline size_t getBudget() const
+    {
+        return m_budget;
+    }
+
+    inline size_t getResidentBytes() const
+    {
+        return m_residentBytes;
+    }
+
+    // levels holds the full chain from level 0, the tail is uploaded right away
+    void registerTexture(const std::shared_ptr<Texture> &texture, std::vector<std::shared_ptr<Buffer<RGBA>>> levels)
+    {
+        // a new texture may take the address of an expired one
+        removeExpired();
+
+        auto state = std::make_shared<StreamedTexture>();
+        state->texture = texture;
+        state->levels = std::move(levels);
+        state->texelSize = Texture::getFormatSize(texture->format);
+
+        uint32_t levelCount = (uint32_t) state->levels.size();
+        uint32_t tailLevel = levelCount - 1;
+        while (tailLevel > 0 && std::max(texture->getLevelWidth(tailLevel - 1), texture->getLevelHeight(tailLevel - 1)) <= TEXTURE_STREAMING_TAIL_SIZE)
+        {
+            tailLevel--;
+        }
+        state->tailLevel = tailLevel;
+        state->residentLevel = tailLevel;
+        state->requestedLevel = (float) tailLevel;
+
+        for (uint32_t level = tailLevel; level < levelCount; level++)
+        {
+            texture->initLevelData(level);
+            texture->setImageSubData(level, 0, (int) state->levels[level]->getHeight(), state->levels[level]->getRawDataPtr());
+            m_residentBytes += getLevelBytes(*state, level);
+        }
+        texture->setLevelRange(tailLevel, levelCount - 1);
+
+        m_textures[texture.get()] = state;
+    }
+
+    inline bool isStreamed(const Texture *texture) const
+    {
+        auto it = m_textures.find(texture);
+        return it != m_textures.end() && !it->second->texture.expired();
+    }
+
+    // the finest level requested in a frame wins
+    void requestLevel(const Texture *texture, float level)
+    {
+        auto it = m_textures.find(texture);
+        if (it == m_textures.end())
+        {
+            return;
+        }
+
+        auto &state = *it->second;
+        if (state.lastRequestFrame != m_frame)
+        {
+            state.lastRequestFrame = m_frame;
+            state.requestedLevel = level;
+        }
+        else
+        {
+            state.requestedLevel = std::min(state.requestedLevel, level);
+        }
+    }
+
+    // mip level that gives about one texel per pixel for a mesh at the given view distance,
+    // projScale is the screen height in pixels divided by 2 * tan(fov / 2)
+    static float computeMipLevel(const Texture &texture, float uvDensity, float distance, float projScale)
+    {
+        float texelsPerUnit = (float) std::max(texture.width, texture.height) * uvDensity;
+        float pixelsPerUnit = projScale / std::max(distance, 1e-4f);
+        return std::log2(std::max(texelsPerUnit / pixelsPerUnit, 1.0f));
+    }
+
+    static MeshTexelDensity computeDensity(const ModelBase &mesh)
+    {
+        MeshTexelDensity density;
+        const Vertex *vertices = mesh.GetVertices();
+        if (0 == mesh.GetVertexCount())
+        {
+            return density;
+        }
+
+        glm::vec3 boundsMin(std::numeric_limits<float>::max());
+        glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+        for (size_t i = 0; i < mesh.GetVertexCount(); i++)
+        {
+            boundsMin = glm::min(boundsMin, vertices[i].position);
+            boundsMax = glm::max(boundsMax, vertices[i].position);
+        }
+        density.center = (boundsMin + boundsMax) * 0.5f;
+        density.radius = glm::length(boundsMax - boundsMin) * 0.5f;
+
+        double surfaceArea = 0.0;
+        double uvArea = 0.0;
+        for (size_t i = 0; i + 2 < mesh.GetIndexCount(); i += 3)
+        {
+            auto &v0 = vertices[mesh.GetIndex(i)];
+            auto &v1 = vertices[mesh.GetIndex(i + 1)];
+            auto &v2 = vertices[mesh.GetIndex(i + 2)];
+            surfaceArea += 0.5 * glm::length(glm::cross(v1.position - v0.position, v2.position - v0.position));
+            glm::vec2 e1 = v1.texCoords - v0.texCoords;
+            glm::vec2 e2 = v2.texCoords - v0.texCoords;
+            uvArea += 0.5 * std::abs(e1.x * e2.y - e1.y * e2.x);
+        }
+        density.uvDensity = surfaceArea > 0.0 ? (float) std::sqrt(uvArea / surfaceArea) : 0.0f;
+        return density;
+    }
+
+    void update(TextureUploader &uploader)
+    {
+        removeExpired();
+
+        std::vector<StreamedTexture *> wanted;
+        for (auto &kv : m_textures)
+        {
+            auto &state = *kv.second;
+            if (!state.uploading && state.residentLevel > 0 && state.residentLevel > getTargetLevel(state))
+            {
+                wanted.push_back(&state);
+            }
+        }
+
+        // largest deficit first, so blurry close textures sharpen before distant ones
+        std::sort(wanted.begin(), wanted.end(), [this](const StreamedTexture *a, const StreamedTexture *b) -> bool {
+            return a->residentLevel - getTargetLevel(*a) > b->residentLevel - getTargetLevel(*b);
+        });
+
+        size_t frameBytes = 0;
+        for (auto *state : wanted)
+        {
+            uint32_t level = state->residentLevel - 1;
+            size_t bytes = getLevelBytes(*state, level);
+            if (frameBytes + bytes > TEXTURE_STREAMING_FRAME_UPLOAD && frameBytes > 0)
+            {
+                break;
+            }
+            if (m_residentBytes + bytes > m_budget && !evict(m_residentBytes + bytes - m_budget, state))
+            {
+                continue;
+            }
+
+            frameBytes += bytes;
+            m_residentBytes += bytes;
+            state->uploading = true;
+            auto texture = state->texture.lock();
+            texture->initLevelData(level);
+
+            // the uploader holds the texture until the level is in
+            std::weak_ptr<StreamedTexture> weakState = m_textures[texture.get()];
+            uploader.uploadLevel(texture, state->levels[level], level, [weakState, level]() {
+                auto streamed = weakState.lock();
+                auto streamedTexture = streamed != nullptr ? streamed->texture.lock() : nullptr;
+                if (streamedTexture != nullptr)
+                {
+                    streamed->uploading = false;
+                    streamed->residentLevel = level;
+                    streamedTexture->setLevelRange(level, (uint32_t) streamed->levels.size() - 1);
+                }
+            });
+        }
+
+        m_frame++;
+    }
+
+private:
+    struct StreamedTexture
+    {
+        std::weak_ptr<Texture> texture;
+        std::vector<std::shared_ptr<Buffer<RGBA>>> levels;
+        size_t texelSize = 0;
+        uint32_t tailLevel = 0;
+        uint32_t residentLevel = 0;
+        float requestedLevel = 0.0f;
+        uint64_t lastRequestFrame = 0;
+        bool uploading = false;
+    };
+
+    uint32_t getTargetLevel(const StreamedTexture &state) const
+    {
+        if (!isRequested(state))
+        {
+            return state.residentLevel;
+        }
+        return std::min(state.tailLevel, (uint32_t) std::max(0.0f, std::floor(state.requestedLevel)));
+    }
+
+    inline bool isRequested(const StreamedTexture &state) const
+    {
+        return state.lastRequestFrame + 1 >= m_frame;
+    }
+
+    inline bool isUnused(const StreamedTexture &state) const
+    {
+        return state.lastRequestFrame + TEXTURE_STREAMING_UNUSED_FRAMES < m_frame;
+    }
+
+    static size_t getLevelBytes(const StreamedTexture &state, uint32_t level)
+    {
+        return state.levels[level]->getWidth() * state.levels[level]->getHeight() * state.texelSize;
+    }
+
+    // the gl texture freed its levels itself, only the budget is given back
+    void removeExpired()
+    {
+        for (auto it = m_textures.begin(); it != m_textures.end();)
+        {
+            auto &state = *it->second;
+            if (state.texture.expired())
+            {
+                for (uint32_t level = state.residentLevel; level < state.levels.size(); level++)
+                {
+                    m_residentBytes -= getLevelBytes(state, level);
+                }
+                it = m_textures.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    // drops top mips of unused textures first, then of textures finer than requested
+    bool evict(size_t bytes, const StreamedTexture *requester)
+    {
+        std::vector<StreamedTexture *> candidates;
+        for (auto &kv : m_textures)
+        {
+            auto &state = *kv.second;
+            if (&state == requester || state.uploading || state.residentLevel >= state.tailLevel)
+            {
+                continue;
+            }
+            if (isUnused(state) || state.residentLevel < getTargetLevel(state))
+            {
+                candidates.push_back(&state);
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end(), [this](const StreamedTexture *a, const StreamedTexture *b) -> bool {
+            if (isUnused(*a) != isUnused(*b))
+            {
+                return isUnused(*a);
+            }
+            return a->lastRequestFrame < b->lastRequestFrame;
+        });
+
+        size_t freed = 0;
+        for (auto *state : candidates)
+        {
+            uint32_t keepLevel = isUnused(*state) ? state->tailLevel : getTargetLevel(*state);
+            auto texture = state->texture.lock();
+            while (freed < bytes && state->residentLevel < keepLevel)
+            {
+                uint32_t level = state->residentLevel;
+                state->residentLevel++;
+                texture->setLevelRange(state->residentLevel, (uint32_t) state->levels.size() - 1);
+                texture->releaseLevelData(level);
+                freed += getLevelBytes(*state, level);
+                m_residentBytes -= getLevelBytes(*state, level);
+            }
+            if (freed >= bytes)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+private:
+    size_t m_budget = TEXTURE_STREAMING_BUDGET;
+    size_t m_residentBytes = 0;
+    uint64_t m_frame = 1;
+    std::unordered_map<const Texture *, std::shared_ptr<StreamedTexture>> m_textures;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _TEXTURE_STREAMER_HPP_
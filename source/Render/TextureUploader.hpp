@@ -0,0 +1,400 @@
+#ifndef _TEXTURE_UPLOADER_HPP_
+#define _TEXTURE_UPLOADER_HPP_
+
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+
+#include "Common/Buffer.hpp"
+#include "Common/Logger.hpp"
+#include "Common/OpenGLExtensions.hpp"
+#include "Common/ThreadPool.hpp"
+#include "Render/Texture.hpp"
+
+BEGIN_NAMESPACE(GLBase)
+
+const size_t TEXTURE_UPLOAD_RING_SIZE = 64 * 1024 * 1024;
+const size_t TEXTURE_UPLOAD_CHUNK_SIZE = 4 * 1024 * 1024;
+const size_t TEXTURE_UPLOAD_FRAME_BUDGET = 32 * 1024 * 1024;
+
+// Streams the mip levels of RGBA8 textures through a ring pixel unpack buffer. Images are
+// split into row chunks, with GL 4.4 buffer storage the ring is persistently mapped
+// and the chunks are copied by worker threads, otherwise the copy happens when the
+// range is mapped. Each transfer is followed by a fence, a ring range is reused and a
+// texture reported resident only after its fence has signaled.
+class TextureUploader
+{
+public:
+    ~TextureUploader()
+    {
+        destroy();
+    }
+
+    void destroy()
+    {
+        m_threadPool = nullptr;
+        for (auto &chunk : m_chunks)
+        {
+            if (chunk.fence != nullptr)
+            {
+                glDeleteSync(chunk.fence);
+            }
+        }
+        m_chunks.clear();
+        m_requests.clear();
+        m_pending.clear();
+
+        if (m_pbo != 0)
+        {
+            if (m_mappedPtr != nullptr)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+                glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                m_mappedPtr = nullptr;
+            }
+            glDeleteBuffers(1, &m_pbo);
+            m_pbo = 0;
+        }
+    }
+
+    // the texture storage must exist, levels are uploaded in order, a single level gets its
+    // mipmaps generated after the last chunk
+    void upload(const std::shared_ptr<Texture> &texture, const std::vector<std::shared_ptr<Buffer<RGBA>>> &levels)
+    {
+        if ((0 == m_pbo && !create()) || levels[0]->getWidth() * sizeof(RGBA) > m_ringSize)
+        {
+            texture->setImageData(levels);
+            return;
+        }
+
+        for (uint32_t level = 0; level < levels.size(); level++)
+        {
+            auto request = createRequest(texture, levels[level], level);
+            request->generateMipmaps = levels.size() == 1;
+            m_requests.push_back(request);
+            // chunks retire in order, the texture is resident with its last level
+            m_pending[texture.get()] = request;
+        }
+    }
+
+    // a single level without mipmap generation, the texture is not tracked as pending
+    void uploadLevel(const std::shared_ptr<Texture> &texture, const std::shared_ptr<Buffer<RGBA>> &buffer, uint32_t level,
+                     const std::function<void()> &onResident)
+    {
+        if ((0 == m_pbo && !create()) || buffer->getWidth() * sizeof(RGBA) > m_ringSize)
+        {
+            texture->setImageSubData(level, 0, (int) buffer->getHeight(), buffer->getRawDataPtr());
+            onResident();
+            return;
+        }
+
+        auto request = createRequest(texture, buffer, level);
+        request->generateMipmaps = false;
+        request->onResident = onResident;
+        m_requests.push_back(request);
+    }
+
+    inline bool isPending(const Texture *texture) const
+    {
+        return m_pending.count(texture) > 0;
+    }
+
+    inline size_t pendingCount() const
+    {
+        return m_pending.size();
+    }
+
+    // retires signaled fences, transfers the copied chunks and starts new copies within the frame budget
+    void update()
+    {
+        if (0 == m_pbo)
+        {
+            return;
+        }
+
+        retireChunks(false);
+        transferChunks(false);
+        copyChunks();
+        transferChunks(false);
+    }
+
+    // blocks until every queued upload is resident
+    void flush()
+    {
+        while (!m_requests.empty() || !m_chunks.empty())
+        {
+            copyChunks();
+            transferChunks(true);
+            retireChunks(true);
+        }
+    }
+
+private:
+    struct UploadRequest
+    {
+        std::shared_ptr<Texture> texture;
+        std::shared_ptr<Buffer<RGBA>> buffer;
+        uint32_t level = 0;
+        bool generateMipmaps = true;
+        std::function<void()> onResident;
+        size_t rowPitch = 0;
+        int rowCount = 0;
+        int rowsCopied = 0;
+        int rowsTransferred = 0;
+    };
+
+    struct UploadChunk
+    {
+        std::shared_ptr<UploadRequest> request;
+        size_t offset = 0;
+        size_t size = 0;
+        int rowStart = 0;
+        int rows = 0;
+        std::shared_ptr<std::atomic<bool>> copied;
+        GLsync fence = nullptr;
+    };
+
+    static std::shared_ptr<UploadRequest> createRequest(const std::shared_ptr<Texture> &texture, const std::shared_ptr<Buffer<RGBA>> &buffer,
+                                                        uint32_t level)
+    {
+        auto request = std::make_shared<UploadRequest>();
+        request->texture = texture;
+        request->buffer = buffer;
+        request->level = level;
+        request->rowPitch = buffer->getWidth() * sizeof(RGBA);
+        request->rowCount = (int) buffer->getHeight();
+        return request;
+    }
+
+    bool create()
+    {
+        glGenBuffers(1, &m_pbo);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+        if (OpenGLExtensions::hasBufferStorage())
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr) m_ringSize, nullptr, flags);
+            m_mappedPtr = (uint8_t *) glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr) m_ringSize, flags);
+            if (nullptr == m_mappedPtr)
+            {
+                LOGW("TextureUploader: persistent map failed, copy on the render thread");
+            }
+        }
+        else
+        {
+            glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr) m_ringSize, nullptr, GL_STREAM_DRAW);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+        if (m_mappedPtr != nullptr)
+        {
+            m_threadPool = std::make_shared<ThreadPool>(2);
+        }
+        return m_pbo != 0;
+    }
+
+    void copyChunks()
+    {
+        size_t budget = TEXTURE_UPLOAD_FRAME_BUDGET;
+        while (!m_requests.empty())
+        {
+            auto request = m_requests.front();
+            int rowsPerChunk = (int) std::max((size_t) 1, TEXTURE_UPLOAD_CHUNK_SIZE / request->rowPitch);
+            int rows = std::min(rowsPerChunk, request->rowCount - request->rowsCopied);
+
+            UploadChunk chunk;
+            chunk.request = request;
+            chunk.rowStart = request->rowsCopied;
+            chunk.rows = rows;
+            chunk.size = rows * request->rowPitch;
+            chunk.copied = std::make_shared<std::atomic<bool>>(false);
+            if (chunk.size > budget || !allocate(chunk.size, chunk.offset))
+            {
+                break;
+            }
+            budget -= chunk.size;
+
+            auto *src = (const uint8_t *) request->buffer->getRawDataPtr() + chunk.rowStart * request->rowPitch;
+            if (m_mappedPtr != nullptr)
+            {
+                uint8_t *dst = m_mappedPtr + chunk.offset;
+                auto buffer = request->buffer;
+                auto copied = chunk.copied;
+                size_t size = chunk.size;
+                m_threadPool->pushTask([buffer, dst, src, size, copied](size_t threadId)
+                                       {
+                                           memcpy(dst, src, size);
+                                           copied->store(true, std::memory_order_release);
+                                       });
+            }
+            else
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+                GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+                void *dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, (GLintptr) chunk.offset, (GLsizeiptr) chunk.size, access);
+                if (dst != nullptr)
+                {
+                    memcpy(dst, src, chunk.size);
+                    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                }
+                else
+                {
+                    LOGE("TextureUploader: map pixel buffer failed");
+                }
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                chunk.copied->store(true);
+            }
+
+            request->rowsCopied += rows;
+            if (request->rowsCopied >= request->rowCount)
+            {
+                m_requests.pop_front();
+            }
+            m_chunks.push_back(std::move(chunk));
+        }
+    }
+
+    // chunks are transferred in order, so a texture's mipmaps see all of its rows
+    void transferChunks(bool wait)
+    {
+        if (wait && m_threadPool != nullptr)
+        {
+            m_threadPool->waitTasksFinish();
+        }
+
+        bool bound = false;
+        for (auto &chunk : m_chunks)
+        {
+            if (chunk.fence != nullptr)
+            {
+                continue;
+            }
+
+            if (!chunk.copied->load(std::memory_order_acquire))
+            {
+                break;
+            }
+
+            if (!bound)
+            {
+                glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
+                bound = true;
+            }
+
+            auto &request = *chunk.request;
+            request.texture->setImageSubData(request.level, chunk.rowStart, chunk.rows, (const void *) chunk.offset);
+            request.rowsTransferred += chunk.rows;
+            if (request.rowsTransferred >= request.rowCount && request.generateMipmaps)
+            {
+                request.texture->generateMipmaps();
+            }
+            chunk.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+
+        if (bound)
+        {
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+    }
+
+    void retireChunks(bool wait)
+    {
+        while (!m_chunks.empty())
+        {
+            auto &chunk = m_chunks.front();
+            if (nullptr == chunk.fence)
+            {
+                break;
+            }
+
+            GLbitfield flags = wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0;
+            GLuint64 timeout = wait ? 1000000000 : 0;
+            GLenum status = glClientWaitSync(chunk.fence, flags, timeout);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            {
+                break;
+            }
+            glDeleteSync(chunk.fence);
+
+            // the last chunk also covers the mipmap generation
+            auto &request = *chunk.request;
+            if (chunk.rowStart + chunk.rows >= request.rowCount)
+            {
+                auto it = m_pending.find(request.texture.get());
+                if (it != m_pending.end() && it->second == chunk.request)
+                {
+                    m_pending.erase(it);
+                }
+                if (request.onResident)
+                {
+                    request.onResident();
+                }
+            }
+            m_chunks.pop_front();
+        }
+
+        if (m_chunks.empty())
+        {
+            m_head = 0;
+        }
+    }
+
+    // ring range after the newest chunk, wraps to the front when the end is too short
+    bool allocate(size_t size, size_t &offset)
+    {
+        size = (size + 255) & ~(size_t) 255;
+        if (size > m_ringSize)
+        {
+            return false;
+        }
+
+        if (m_chunks.empty())
+        {
+            offset = 0;
+            m_head = size;
+            return true;
+        }
+
+        size_t tail = m_chunks.front().offset;
+        if (m_head >= tail)
+        {
+            if (m_head + size <= m_ringSize)
+            {
+                offset = m_head;
+                m_head += size;
+                return true;
+            }
+            if (size < tail)
+            {
+                offset = 0;
+                m_head = size;
+                return true;
+            }
+            return false;
+        }
+
+        if (m_head + size < tail)
+        {
+            offset = m_head;
+            m_head += size;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    GLuint m_pbo = 0;
+    uint8_t *m_mappedPtr = nullptr;
+    size_t m_ringSize = TEXTURE_UPLOAD_RING_SIZE;
+    size_t m_head = 0;
+
+    std::shared_ptr<ThreadPool> m_threadPool = nullptr;
+    std::deque<std::shared_ptr<UploadRequest>> m_requests;
+    std::deque<UploadChunk> m_chunks;
+    std::unordered_map<const Texture *, std::shared_ptr<UploadRequest>> m_pending;
+};
+
+END_NAMESPACE(GLBase)
+
+#endif // _TEXTURE_UPLOADER_HPP_
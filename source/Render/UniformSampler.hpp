@@ -44,6 +44,7 @@ public:
                 break;
         }
         glBindTexture(m_texTarget, m_texId);
+        glBindSampler(binding, m_samplerId);
         glUniform1i(location, binding);
     }
 
@@ -62,6 +63,7 @@ public:
                 break;
         }
         m_texId = tex->getId();
+        m_samplerId = tex->getSamplerId();
     }
 
 private:
@@ -69,6 +71,7 @@ private:
     TextureFormat m_texFormat;
     GLuint m_texTarget = 0;
     GLuint m_texId = 0;
+    GLuint m_samplerId = 0;
 };
 
 END_NAMESPACE(GLBase)
@@ -5,11 +5,27 @@
 
 BEGIN_NAMESPACE(GLBase)
 
+enum class VertexAttributeType
+{
+    FLOAT32 = 0,
+    FLOAT16,
+    INT16,
+    UINT16,
+};
+
+enum class IndexType
+{
+    UINT32 = 0,
+    UINT16,
+};
+
 struct VertexAttributeDesc
 {
     size_t size; // number of components
     size_t stride;
     size_t offset;
+    VertexAttributeType type;
+    bool normalized; // integer types read as [-1, 1] or [0, 1]
 };
 
 struct VertexArray
@@ -20,8 +36,9 @@ struct VertexArray
     uint8_t *vertexBuffer = nullptr;
     size_t vertexBufferLength = 0;
 
-    int32_t *indexBuffer = nullptr;
-    size_t indexBufferLength = 0;
+    uint8_t *indexBuffer = nullptr;
+    size_t indexBufferLength = 0; // bytes
+    IndexType indexType = IndexType::UINT32;
 };
 
 END_NAMESPACE(GLBase)
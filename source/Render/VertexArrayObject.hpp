@@ -6,6 +6,7 @@
 #include <glad/glad.h>
 
 #include "Common/OpenGLUtils.hpp"
+#include "Render/EnumsOpenGL.hpp"
 #include "Render/Vertex.hpp"
 
 BEGIN_NAMESPACE(GLBase)
@@ -18,7 +19,8 @@ public:
         if (nullptr == vertexArray.vertexBuffer || nullptr == vertexArray.indexBuffer)
             return;
 
-        m_indicesCount = vertexArray.indexBufferLength / sizeof(int);
+        m_indexType = cvtIndexType(vertexArray.indexType);
+        m_indicesCount = vertexArray.indexBufferLength / (IndexType::UINT16 == vertexArray.indexType ? sizeof(uint16_t) : sizeof(uint32_t));
 
         // vao
         GL_CHECK(glGenVertexArrays(1, &m_vao));
@@ -30,7 +32,7 @@ public:
         for(int i = 0; i < vertexArray.attributes.size(); i++)
         {
             const auto &attr = vertexArray.attributes[i];
-            GL_CHECK(glVertexAttribPointer(i, attr.size, GL_FLOAT, GL_FALSE, attr.stride, (void*)attr.offset));
+            GL_CHECK(glVertexAttribPointer(i, attr.size, cvtVertexAttributeType(attr.type), attr.normalized ? GL_TRUE : GL_FALSE, attr.stride, (void*)attr.offset));
             GL_CHECK(glEnableVertexAttribArray(i));
         }
         // ebo
@@ -45,6 +47,8 @@ public:
             GL_CHECK(glDeleteBuffers(1, &m_vbo));
         if (m_ebo != 0)
             GL_CHECK(glDeleteBuffers(1, &m_ebo));
+        if (m_drawIdBuffer != 0)
+            GL_CHECK(glDeleteBuffers(1, &m_drawIdBuffer));
         if (m_vao != 0)
             GL_CHECK(glDeleteVertexArrays(1, &m_vao));
     }
@@ -60,6 +64,11 @@ public:
         return m_indicesCount;
     }
 
+    inline GLenum getIndexType() const
+    {
+        return m_indexType;
+    }
+
     void bind() const
     {
         if (m_vao != 0)
@@ -72,11 +81,34 @@ public:
         GL_CHECK(glBufferData(GL_ARRAY_BUFFER, length, data, GL_STATIC_DRAW));
     }
 
+    // per instance uint attribute 0..count-1, indirect draws select it with baseInstance
+    void setDrawIdAttribute(GLuint location, size_t count)
+    {
+        std::vector<uint32_t> drawIds(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            drawIds[i] = (uint32_t) i;
+        }
+
+        GL_CHECK(glBindVertexArray(m_vao));
+        if (0 == m_drawIdBuffer)
+        {
+            GL_CHECK(glGenBuffers(1, &m_drawIdBuffer));
+        }
+        GL_CHECK(glBindBuffer(GL_ARRAY_BUFFER, m_drawIdBuffer));
+        GL_CHECK(glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(uint32_t), drawIds.data(), GL_STATIC_DRAW));
+        GL_CHECK(glVertexAttribIPointer(location, 1, GL_UNSIGNED_INT, sizeof(uint32_t), nullptr));
+        GL_CHECK(glEnableVertexAttribArray(location));
+        GL_CHECK(glVertexAttribDivisor(location, 1));
+    }
+
 private:
     GLuint m_vao = 0;
     GLuint m_vbo = 0;
     GLuint m_ebo = 0;
+    GLuint m_drawIdBuffer = 0;
     size_t m_indicesCount = 0;
+    GLenum m_indexType = GL_UNSIGNED_INT;
 };
 
 END_NAMESPACE(GLBase)
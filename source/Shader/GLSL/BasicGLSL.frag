@@ -2,16 +2,16 @@ in vec2 v_texCoord;
 
 out vec4 FragColor;
 
-layout(binding = 1, std140) uniform UniformsMaterial
-{
-    vec4 u_baseColor;
-    float u_kSpecular;
-};
+#include "Include/UniformsMaterial.glsl"
 
 uniform sampler2D u_albedoMap;
 
 void main()
 {
+#if defined(ALBEDO_MAP) || !defined(FALLBACK)
     vec4 baseColor = texture(u_albedoMap, v_texCoord);
+#else
+    vec4 baseColor = u_baseColor;
+#endif
     FragColor = baseColor;
 }
\ No newline at end of file
@@ -1,3 +1,5 @@
+#include "Include/UberShader.glsl"
+
 in vec2 v_texCoords;
 in vec3 v_worldPos;
 in vec3 v_worldNormal;
@@ -11,26 +13,9 @@ in vec3 v_worldTangent;
 
 out vec4 FragColor;
 
-layout (binding = 0, std140) uniform UniformsModel {
-    mat4 u_modelMatrix;
-    mat4 u_modelViewProjectionMatrix;
-    mat3 u_inverseTransposeModelMatrix;
-    mat4 u_shadowMVPMatrix;
-};
-
-layout(binding = 1, std140) uniform UniformsScene
-{
-    vec3 u_ambientColor;
-    vec3 u_cameraPosition;
-    vec3 u_pointLightPosition;
-    vec3 u_pointLightColor;
-};
-
-layout(binding = 2, std140) uniform UniformsMaterial
-{
-    float u_kSpecular;
-    vec4 u_baseColor;
-};
+#include "Include/UniformsModel.glsl"
+#include "Include/UniformsScene.glsl"
+#include "Include/UniformsMaterial.glsl"
 
 #if defined(ALBEDO_MAP)
 uniform sampler2D u_albedoMap;
@@ -50,24 +35,43 @@ uniform sampler2D u_aoMap;
 
 uniform sampler2D u_shadowMap;
 
+#if defined(CLUSTERED_LIGHTING)
+#include "Include/Lights.glsl"
+
+// (offset, count) into u_clusterLightIndices per cluster
+layout(std430) readonly buffer ClusterLightGrid
+{
+    uvec2 u_clusterLightGrid[];
+};
+
+layout(std430) readonly buffer ClusterLightIndices
+{
+    uint u_clusterLightIndices[];
+};
+#endif
+
 const float depthBiasCoeff = 0.00025;
 const float depthBiasMin = 0.00005;
 
 vec3 GetNormal()
 {
 #if defined(NORMAL_MAP)
-    vec3 N = normalize(v_worldNormal);
-    vec3 T = normalize(v_worldTangent);
-    T = normalize(T - dot(T, N) * N);
-    vec3 B = cross(T, N);
-    mat3 TBN = mat3(T, B, N);
-
-    vec3 tangentNormal = texture(u_normalMap, v_texCoords).rgb;
-    tangentNormal = tangentNormal * 2.0 - 1.0;
-    return normalize(TBN * tangentNormal);
-#else
-    return normalize(v_worldNormal);
+    if (HAS_TEXTURE(TEXTURE_NORMAL))
+    {
+        vec3 N = normalize(v_worldNormal);
+        vec3 T = normalize(v_worldTangent);
+        T = normalize(T - dot(T, N) * N);
+        vec3 B = cross(T, N);
+        mat3 TBN = mat3(T, B, N);
+
+        // z is rebuilt from xy, two channel (BC5) normal maps have no blue
+        vec3 tangentNormal;
+        tangentNormal.xy = texture(u_normalMap, v_texCoords).rg * 2.0 - 1.0;
+        tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+        return normalize(TBN * tangentNormal);
+    }
 #endif
+    return normalize(v_worldNormal);
 }
 
 float ShadowCalculation(vec4 fragPos, vec3 normal)
@@ -103,12 +107,42 @@ float ShadowCalculation(vec4 fragPos, vec3 normal)
     return shadow;
 }
 
+#if defined(CLUSTERED_LIGHTING)
+vec3 ClusteredLighting(vec3 N, vec3 V, vec3 albedo)
+{
+    float depth = -(u_viewMatrix * vec4(v_worldPos, 1.0)).z;
+    float slice = floor(log(max(depth, u_clusterDepthParams.z)) * u_clusterDepthParams.x + u_clusterDepthParams.y);
+    uvec3 cluster = uvec3(clamp(vec3(gl_FragCoord.xy / vec2(u_screenSize) * vec2(u_clusterGridSize.xy), slice),
+                                vec3(0.0), vec3(u_clusterGridSize.xyz) - 1.0));
+    uint clusterIdx = (cluster.z * u_clusterGridSize.y + cluster.y) * u_clusterGridSize.x + cluster.x;
+    uvec2 range = u_clusterLightGrid[clusterIdx];
+
+    vec3 color = vec3(0.0);
+    for (uint i = 0u; i < range.y; i++)
+    {
+        PointLight light = u_pointLights[u_clusterLightIndices[range.x + i]];
+        vec3 toLight = light.position - v_worldPos;
+        float dist = length(toLight);
+        float falloff = clamp(1.0 - pow(dist / light.radius, 4.0), 0.0, 1.0);
+        vec3 lightColor = light.color * light.intensity * falloff * falloff / (dist * dist + 1.0);
+
+        vec3 lightDir = toLight / max(dist, 0.0001);
+        vec3 halfwayDir = normalize(lightDir + V);
+        color += lightColor * max(dot(lightDir, N), 0.0) * albedo;
+        color += lightColor * u_kSpecular * pow(max(dot(N, halfwayDir), 0.0), 128.0);
+    }
+    return color;
+}
+#endif
+
 void main()
 {
-#if defined(ALBEDO_MAP)
-    vec4 baseColor = texture(u_albedoMap, v_texCoords);
-#else
     vec4 baseColor = u_baseColor;
+#if defined(ALBEDO_MAP)
+    if (HAS_TEXTURE(TEXTURE_ALBEDO))
+    {
+        baseColor = texture(u_albedoMap, v_texCoords);
+    }
 #endif
 
     vec3 N = GetNormal();
@@ -116,7 +150,10 @@ void main()
     // ambient
     float ao = 1.0;
 #if defined(AO_MAP)
-    ao = texture(u_aoMap, v_texCoords).r;
+    if (HAS_TEXTURE(TEXTURE_AMBIENT_OCCLUSION))
+    {
+        ao = texture(u_aoMap, v_texCoords).r;
+    }
 #endif
     vec3 ambient = baseColor.rgb * u_ambientColor * ao;
 
@@ -138,8 +175,16 @@ void main()
 
     vec3 emissive = vec3(0.0);
 #if defined(EMISSIVE_MAP)
-    emissive = texture(u_emissiveMap, v_texCoords).rgb;
+    if (HAS_TEXTURE(TEXTURE_EMISSIVE))
+    {
+        emissive = texture(u_emissiveMap, v_texCoords).rgb;
+    }
+#endif
+
+    vec3 color = ambient + diffuse + specular + emissive;
+#if defined(CLUSTERED_LIGHTING)
+    color += ClusteredLighting(N, viewDir, baseColor.rgb);
 #endif
 
-    FragColor = vec4(ambient + diffuse + specular + emissive, baseColor.a);
+    FragColor = vec4(color, baseColor.a);
 }
\ No newline at end of file
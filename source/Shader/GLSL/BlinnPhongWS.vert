@@ -1,7 +1,13 @@
+#include "Include/UberShader.glsl"
+
 layout(location = 0) in vec3 a_position;
 layout(location = 1) in vec2 a_texCoords;
-layout(location = 2) in vec3 a_normal;
-layout(location = 3) in vec3 a_tangent;
+#include "Include/VertexInput.glsl"
+#if defined(GPU_DRIVEN)
+layout(location = 4) in uint a_drawId;
+
+#include "Include/DrawInstances.glsl"
+#endif
 
 out vec2 v_texCoords;
 out vec3 v_worldPos;
@@ -14,37 +20,35 @@ out vec4 v_shadowFragPos;
 out vec3 v_worldTangent;
 #endif
 
-layout(binding = 0, std140) uniform UniformsModel
-{
-    mat4 u_modelMatrix;
-    mat4 u_modelViewProjectionMatrix;
-    mat3 u_inverseTransposeModelMatrix;
-    mat4 u_shadowMVPMatrix;
-};
-
-layout(binding = 1, std140) uniform UniformsScene
-{
-    vec3 u_ambientColor;
-    vec3 u_cameraPosition;
-    vec3 u_pointLightPosition;
-    vec3 u_pointLightColor;
-};
+#include "Include/UniformsModel.glsl"
+#include "Include/UniformsScene.glsl"
 
 void main()
 {
     vec4 position = vec4(a_position, 1.0);
+    vec3 normal = VERTEX_NORMAL;
+    vec3 tangent = VERTEX_TANGENT;
+
+#if defined(GPU_DRIVEN)
+    // u_modelMatrix is identity here, per draw transforms come from the instance buffer
+    DrawInstance instance = u_drawInstances[a_drawId];
+    position = instance.modelMatrix * position;
+    normal = mat3(instance.normalMatrix) * normal;
+    tangent = mat3(instance.normalMatrix) * tangent;
+#endif
+
     gl_Position = u_modelViewProjectionMatrix * position;
     v_texCoords = a_texCoords;
     v_shadowFragPos = u_shadowMVPMatrix * position;
 
     v_worldPos = vec3(u_modelMatrix * position);
-    v_worldNormal = mat3(u_modelMatrix) * a_normal;
+    v_worldNormal = mat3(u_inverseTransposeModelMatrix) * normal;
     v_worldLightDir = u_pointLightPosition - v_worldPos;
     v_worldViewDir = u_cameraPosition - v_worldPos;
 
 #if defined(NORMAL_MAP)
-    vec3 N = normalize(mat3(u_inverseTransposeModelMatrix) * a_normal);
-    vec3 T = normalize(mat3(u_inverseTransposeModelMatrix) * a_tangent);
+    vec3 N = normalize(mat3(u_inverseTransposeModelMatrix) * normal);
+    vec3 T = normalize(mat3(u_inverseTransposeModelMatrix) * tangent);
     v_worldNormal = N;
     v_worldTangent = normalize(T - dot(T, N) * N);
 #endif
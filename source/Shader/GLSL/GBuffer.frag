@@ -0,0 +1,73 @@
+in vec2 v_texCoords;
+in vec3 v_worldPos;
+in vec3 v_worldNormal;
+
+#if defined(NORMAL_MAP)
+in vec3 v_worldTangent;
+#endif
+
+layout(location = 0) out vec4 gAlbedo;   // rgb: albedo, a: ambient occlusion
+layout(location = 1) out vec4 gNormal;   // xyz: world normal, w: specular
+layout(location = 2) out vec4 gPosition; // xyz: world position, w: coverage
+layout(location = 3) out vec4 gEmissive;
+
+#include "Include/UniformsMaterial.glsl"
+
+#if defined(ALBEDO_MAP)
+uniform sampler2D u_albedoMap;
+#endif
+
+#if defined(NORMAL_MAP)
+uniform sampler2D u_normalMap;
+#endif
+
+#if defined(EMISSIVE_MAP)
+uniform sampler2D u_emissiveMap;
+#endif
+
+#if defined(AO_MAP)
+uniform sampler2D u_aoMap;
+#endif
+
+vec3 GetNormal()
+{
+#if defined(NORMAL_MAP)
+    vec3 N = normalize(v_worldNormal);
+    vec3 T = normalize(v_worldTangent);
+    T = normalize(T - dot(T, N) * N);
+    vec3 B = cross(T, N);
+    mat3 TBN = mat3(T, B, N);
+
+    // z is rebuilt from xy, two channel (BC5) normal maps have no blue
+    vec3 tangentNormal;
+    tangentNormal.xy = texture(u_normalMap, v_texCoords).rg * 2.0 - 1.0;
+    tangentNormal.z = sqrt(max(1.0 - dot(tangentNormal.xy, tangentNormal.xy), 0.0));
+    return normalize(TBN * tangentNormal);
+#else
+    return normalize(v_worldNormal);
+#endif
+}
+
+void main()
+{
+#if defined(ALBEDO_MAP)
+    vec4 baseColor = texture(u_albedoMap, v_texCoords);
+#else
+    vec4 baseColor = u_baseColor;
+#endif
+
+    float ao = 1.0;
+#if defined(AO_MAP)
+    ao = texture(u_aoMap, v_texCoords).r;
+#endif
+
+    vec3 emissive = vec3(0.0);
+#if defined(EMISSIVE_MAP)
+    emissive = texture(u_emissiveMap, v_texCoords).rgb;
+#endif
+
+    gAlbedo = vec4(baseColor.rgb, ao);
+    gNormal = vec4(GetNormal(), u_kSpecular);
+    gPosition = vec4(v_worldPos, 1.0);
+    gEmissive = vec4(emissive, 1.0);
+}
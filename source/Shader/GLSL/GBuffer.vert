@@ -0,0 +1,44 @@
+layout(location = 0) in vec3 a_position;
+layout(location = 1) in vec2 a_texCoords;
+#include "Include/VertexInput.glsl"
+#if defined(GPU_DRIVEN)
+layout(location = 4) in uint a_drawId;
+
+#include "Include/DrawInstances.glsl"
+#endif
+
+out vec2 v_texCoords;
+out vec3 v_worldPos;
+out vec3 v_worldNormal;
+
+#if defined(NORMAL_MAP)
+out vec3 v_worldTangent;
+#endif
+
+#include "Include/UniformsModel.glsl"
+
+void main()
+{
+    vec4 position = vec4(a_position, 1.0);
+    vec3 normal = VERTEX_NORMAL;
+    vec3 tangent = VERTEX_TANGENT;
+
+#if defined(GPU_DRIVEN)
+    // u_modelMatrix is identity here, per draw transforms come from the instance buffer
+    DrawInstance instance = u_drawInstances[a_drawId];
+    position = instance.modelMatrix * position;
+    normal = mat3(instance.normalMatrix) * normal;
+    tangent = mat3(instance.normalMatrix) * tangent;
+#endif
+
+    gl_Position = u_modelViewProjectionMatrix * position;
+    v_texCoords = a_texCoords;
+
+    v_worldPos = vec3(u_modelMatrix * position);
+    v_worldNormal = normalize(mat3(u_inverseTransposeModelMatrix) * normal);
+
+#if defined(NORMAL_MAP)
+    vec3 T = normalize(mat3(u_inverseTransposeModelMatrix) * tangent);
+    v_worldTangent = normalize(T - dot(T, v_worldNormal) * v_worldNormal);
+#endif
+}
@@ -0,0 +1,16 @@
+// matches struct DrawInstance in GPUDrivenScene.hpp
+struct DrawInstance
+{
+    mat4 modelMatrix;
+    mat4 normalMatrix;
+    vec4 boundsMin;
+    vec4 boundsMax;
+    uvec4 drawParams;
+    uvec4 drawFlags;
+    vec4 cone;
+};
+
+layout(std430) readonly buffer DrawInstances
+{
+    DrawInstance u_drawInstances[];
+};
@@ -0,0 +1,24 @@
+struct PointLight
+{
+    vec3 position;
+    float radius;
+    vec3 color;
+    float intensity;
+};
+
+layout(std140) uniform UniformsLights
+{
+    mat4 u_viewMatrix;
+    mat4 u_projectionMatrix;
+    mat4 u_inverseProjectionMatrix;
+    mat4 u_shadowVPMatrix;
+    ivec2 u_screenSize;
+    int u_pointLightCount;
+    uvec4 u_clusterGridSize;
+    vec4 u_clusterDepthParams;
+};
+
+layout(std430) readonly buffer PointLights
+{
+    PointLight u_pointLights[];
+};
@@ -0,0 +1,16 @@
+// UBER_SHADER builds one program for every texture combination, texture presence
+// is read from u_textureFlags (bit index is MaterialTexType) and branches uniformly
+#define TEXTURE_ALBEDO              1u
+#define TEXTURE_NORMAL              2u
+#define TEXTURE_EMISSIVE            3u
+#define TEXTURE_AMBIENT_OCCLUSION   4u
+
+#if defined(UBER_SHADER)
+#define ALBEDO_MAP
+#define NORMAL_MAP
+#define EMISSIVE_MAP
+#define AO_MAP
+#define HAS_TEXTURE(type) ((u_textureFlags & (1u << type)) != 0u)
+#else
+#define HAS_TEXTURE(type) true
+#endif
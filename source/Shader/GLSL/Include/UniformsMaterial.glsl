@@ -0,0 +1,6 @@
+layout(std140) uniform UniformsMaterial
+{
+    float u_kSpecular;
+    vec4 u_baseColor;
+    uint u_textureFlags;
+};
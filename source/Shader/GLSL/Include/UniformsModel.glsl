@@ -0,0 +1,7 @@
+layout(std140) uniform UniformsModel
+{
+    mat4 u_modelMatrix;
+    mat4 u_modelViewProjectionMatrix;
+    mat3 u_inverseTransposeModelMatrix;
+    mat4 u_shadowMVPMatrix;
+};
@@ -0,0 +1,7 @@
+layout(std140) uniform UniformsScene
+{
+    vec3 u_ambientColor;
+    vec3 u_cameraPosition;
+    vec3 u_pointLightPosition;
+    vec3 u_pointLightColor;
+};
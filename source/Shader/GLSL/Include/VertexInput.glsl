@@ -0,0 +1,23 @@
+// normal and tangent inputs, PACKED_VERTEX stores them octahedral encoded in
+// two snorm16 components, see ModelBase::InitVertexArray
+#if defined(PACKED_VERTEX)
+layout(location = 2) in vec2 a_normal;
+layout(location = 3) in vec2 a_tangent;
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += vec2(v.x >= 0.0 ? -t : t, v.y >= 0.0 ? -t : t);
+    return normalize(v);
+}
+
+#define VERTEX_NORMAL OctDecode(a_normal)
+#define VERTEX_TANGENT OctDecode(a_tangent)
+#else
+layout(location = 2) in vec3 a_normal;
+layout(location = 3) in vec3 a_tangent;
+
+#define VERTEX_NORMAL a_normal
+#define VERTEX_TANGENT a_tangent
+#endif
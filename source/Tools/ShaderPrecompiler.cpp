@@ -0,0 +1,193 @@
+#include "Common/cpplang.hpp"
+
+#include <glad/glad.h>
+// GLFW (include after glad)
+#include <glfw/glfw3.h>
+#include "Common/GLMInc.hpp"
+
+#include "Common/FileUtils.hpp"
+#include "Common/Logger.hpp"
+#include "Common/OpenGLExtensions.hpp"
+#include "Model/ModelLoader.hpp"
+#include "Render/GLSLPreprocessor.hpp"
+#include "Render/Renderer.hpp"
+#include "Viewer/Camera.hpp"
+
+// Enumerates the shader variants reachable by the given assets for every render path,
+// compiles them once to validate and to fill the program binary cache, and writes a
+// manifest. Run it on the target machine, binaries are only valid for the same driver.
+//
+// usage: ShaderPrecompiler [--manifest file] [--dry-run] [model.gltf ...]
+
+const std::string DEFAULT_MANIFEST = "./ShaderVariants.txt";
+const std::string DEFAULT_MODEL = "../assets/GlassTable/scene.gltf";
+
+struct RenderConfig
+{
+    GLBase::RenderPath renderPath;
+    bool gpuDriven;
+};
+
+bool preprocessVariant(const GLBase::ShaderVariant &variant)
+{
+    auto check = [](const std::string &path, GLenum type) -> bool {
+        const std::string &source = GLBase::GLSLPreprocessor::readFile(path);
+        return !source.empty() && !GLBase::GLSLPreprocessor::preprocess(source, type).empty();
+    };
+
+    if (variant.isCompute())
+    {
+        return check(variant.csPath, GL_COMPUTE_SHADER);
+    }
+    return check(variant.vsPath, GL_VERTEX_SHADER) && check(variant.fsPath, GL_FRAGMENT_SHADER);
+}
+
+int main(int argc, char **argv)
+{
+    std::string manifestPath = DEFAULT_MANIFEST;
+    std::vector<std::string> modelPaths;
+    bool dryRun = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--manifest" && i + 1 < argc)
+        {
+            manifestPath = argv[++i];
+        }
+        else if (arg == "--dry-run")
+        {
+            dryRun = true;
+        }
+        else
+        {
+            modelPaths.push_back(arg);
+        }
+    }
+
+    if (modelPaths.empty())
+    {
+        modelPaths.push_back(DEFAULT_MODEL);
+    }
+
+    if (!glfwInit())
+    {
+        LOGE("Failed to initialize GLFW.");
+        return -1;
+    }
+
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+    GLFWwindow *window = glfwCreateWindow(64, 64, "ShaderPrecompiler", nullptr, nullptr);
+    if (nullptr == window)
+    {
+        LOGE("Failed to create GLFW window.");
+        glfwTerminate();
+        return -1;
+    }
+
+    glfwMakeContextCurrent(window);
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    {
+        LOGE("Failed to initialize GLAD.");
+        glfwTerminate();
+        return -1;
+    }
+    GLBase::OpenGLExtensions::load((GLADloadproc)glfwGetProcAddress);
+
+    if (!dryRun && !GLBase::OpenGLExtensions::hasProgramBinary())
+    {
+        LOGW("program binary not supported, variants are validated only");
+    }
+
+    // same render path fallbacks as Renderer::drawFrame
+    std::vector<RenderConfig> configs;
+    for (auto renderPath : {GLBase::RenderPath::Forward, GLBase::RenderPath::Deferred, GLBase::RenderPath::ForwardClustered})
+    {
+        if (GLBase::RenderPath::Deferred == renderPath && !GLBase::OpenGLExtensions::hasComputeShader())
+            continue;
+        if (GLBase::RenderPath::ForwardClustered == renderPath && !GLBase::OpenGLExtensions::hasShaderStorageBuffer())
+            continue;
+
+        configs.push_back({renderPath, false});
+        if (GLBase::OpenGLExtensions::hasIndirectDraw())
+        {
+            configs.push_back({renderPath, true});
+        }
+    }
+
+    auto camera = std::make_shared<GLBase::Camera>(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+    std::vector<GLBase::ShaderVariant> variants;
+    std::unordered_set<std::string> variantNames;
+    for (auto &modelPath : modelPaths)
+    {
+        GLBase::ModelLoader modelLoader;
+        // variants do not depend on texture formats
+        modelLoader.setTextureCompression(false);
+        modelLoader.loadFloor(modelLoader.getScene().floor);
+        modelLoader.loadCube(modelLoader.getScene().cube);
+        if (!modelLoader.loadModel(modelPath))
+        {
+            LOGE("load model failed: %s", modelPath.c_str());
+            continue;
+        }
+
+        GLBase::Renderer renderer;
+        renderer.create(camera, modelLoader.getScene());
+        // Auto reaches both the uber shader and every specialized variant
+        renderer.setShaderVariantMode(GLBase::ShaderVariantMode::Auto);
+        for (auto &config : configs)
+        {
+            renderer.setRenderPath(config.renderPath);
+            renderer.setGPUDriven(config.gpuDriven);
+            for (auto &variant : renderer.collectShaderVariants())
+            {
+                if (variantNames.insert(variant.name()).second)
+                {
+                    variants.push_back(variant);
+                }
+            }
+        }
+    }
+
+    LOGI("shader variants: %d", variants.size());
+
+    std::string manifest;
+    int failedCount = 0;
+    for (auto &variant : variants)
+    {
+        bool success = preprocessVariant(variant);
+        uint64_t binaryKey = 0;
+        if (success && !dryRun)
+        {
+            GLBase::ShaderProgram program;
+            success = program.compileAndLinkVariant(variant);
+            binaryKey = program.getBinaryKey();
+        }
+
+        if (!success)
+        {
+            LOGE("shader variant failed: %s", variant.name().c_str());
+            failedCount++;
+        }
+
+        char keyStr[32];
+        snprintf(keyStr, sizeof(keyStr), "%016llx", (unsigned long long) binaryKey);
+        manifest += std::string(success ? "ok " : "failed ") + keyStr + " " + variant.name() + "\n";
+    }
+
+    if (!GLBase::FileUtils::writeText(manifestPath, manifest))
+    {
+        failedCount++;
+    }
+    LOGI("shader variants failed: %d, manifest: %s", failedCount, manifestPath.c_str());
+
+    glfwDestroyWindow(window);
+    glfwTerminate();
+
+    return failedCount > 0 ? 1 : 0;
+}
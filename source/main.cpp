@@ -6,6 +6,7 @@
 #include "Common/GLMInc.hpp"
 
 #include "Common/Logger.hpp"
+#include "Common/OpenGLExtensions.hpp"
 #include "Model/AsModel.hpp"
 #include "Model/Cube.hpp"
 #include "Model/Floor.hpp"
@@ -115,6 +116,7 @@ int main()
         glfwTerminate();
         return -1;
     }
+    GLBase::OpenGLExtensions::load((GLADloadproc)glfwGetProcAddress);
 
     g_camera = std::make_shared<GLBase::Camera>(g_cameraPos, g_cameraPos + g_cameraFront, g_cameraUp);
     g_camera->setPerspective(glm::radians(GLBase::CAMERA_FOV), (float)GLBase::SCREEN_WIDTH / (float)GLBase::SCREEN_HEIGHT, GLBase::CAMERA_NEAR, GLBase::CAMERA_FAR);
@@ -127,9 +129,13 @@ int main()
     model = glm::translate(model, glm::vec3(-1.0f, 1.5f, 1.2f));
     model = glm::scale(model, glm::vec3(0.01f));
     modelLoader.loadModel("../assets/GlassTable/scene.gltf", model);
+    modelLoader.loadPointLights(256, 16.0f, 0.0f, 1.5f);
 
     GLBase::Renderer renderer;
     renderer.create(g_camera, modelLoader.getScene());
+    renderer.setRenderPath(GLBase::RenderPath::ForwardClustered);
+    renderer.setGPUDriven(true);
+    renderer.setShaderVariantMode(GLBase::ShaderVariantMode::Auto);
 
     glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
     glEnable(GL_DEPTH_TEST);